@@ -1,10 +1,47 @@
+#include "UnitDeadArgs.h"
+#include "UnitGlobalSCCP.h"
 #include "UnitLICM.h"
 #include "UnitLoopInfo.h"
 #include "UnitSCCP.h"
+#include "UnitSpecialize.h"
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/Passes/PassPlugin.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
 
+// Off by default, so loading the plugin leaves -O2/-O3 stock. Plugin options
+// need the library loaded with -load as well under opt, or with
+// -Xclang -load under clang
+static cl::opt<bool> UnitDefaultPipeline(
+    "unit-default-pipeline", cl::init(false),
+    cl::desc("Add the unit passes to the default -O1/-O2/-O3 pipelines"));
+
+/// Join the default pipelines: SCCP once the scalar optimizer is done and
+/// after each instcombine, LICM at the end of the loop optimizer, and the
+/// interprocedural passes where ipsccp runs, after the early cleanup
+static void registerExtensionPoints(PassBuilder& PB) {
+    PB.registerScalarOptimizerLateEPCallback(
+        [](FunctionPassManager& FPM, OptimizationLevel) {
+            FPM.addPass(cs426::UnitSCCP());
+        });
+    PB.registerLoopOptimizerEndEPCallback(
+        [](LoopPassManager& LPM, OptimizationLevel) {
+            LPM.addPass(cs426::UnitLoopLICM());
+        });
+    PB.registerPeepholeEPCallback(
+        [](FunctionPassManager& FPM, OptimizationLevel Level) {
+            if (Level != OptimizationLevel::O0)
+                FPM.addPass(cs426::UnitSCCP());
+        });
+    PB.registerPipelineEarlySimplificationEPCallback(
+        [](ModulePassManager& MPM, OptimizationLevel Level) {
+            MPM.addPass(cs426::UnitGlobalSCCP());
+            if (Level == OptimizationLevel::O3)
+                MPM.addPass(cs426::UnitSpecialize());
+            MPM.addPass(cs426::UnitDeadArgs());
+        });
+}
+
 /// Registers the three passes for this project with LLVM's pass mananger
 llvm::PassPluginLibraryInfo getUnitProjectPluginInfo() {
     return {LLVM_PLUGIN_API_VERSION, "CS426 Unit Project", LLVM_VERSION_STRING,
@@ -24,6 +61,16 @@ llvm::PassPluginLibraryInfo getUnitProjectPluginInfo() {
                         }
                         return false;
                     });
+                // The same name inside loop(...) or loop-mssa(...)
+                PB.registerPipelineParsingCallback(
+                    [](StringRef Name, LoopPassManager& LPM,
+                       ArrayRef<PassBuilder::PipelineElement>) {
+                        if (Name == "unit-licm") {
+                            LPM.addPass(cs426::UnitLoopLICM());
+                            return true;
+                        }
+                        return false;
+                    });
                 // Register SCCP
                 PB.registerPipelineParsingCallback(
                     [](StringRef Name, FunctionPassManager& FPM,
@@ -34,6 +81,38 @@ llvm::PassPluginLibraryInfo getUnitProjectPluginInfo() {
                         }
                         return false;
                     });
+                // Register global constant propagation
+                PB.registerPipelineParsingCallback(
+                    [](StringRef Name, ModulePassManager& MPM,
+                       ArrayRef<PassBuilder::PipelineElement>) {
+                        if (Name == "unit-global-sccp") {
+                            MPM.addPass(cs426::UnitGlobalSCCP());
+                            return true;
+                        }
+                        return false;
+                    });
+                // Register function specialization
+                PB.registerPipelineParsingCallback(
+                    [](StringRef Name, ModulePassManager& MPM,
+                       ArrayRef<PassBuilder::PipelineElement>) {
+                        if (Name == "unit-specialize") {
+                            MPM.addPass(cs426::UnitSpecialize());
+                            return true;
+                        }
+                        return false;
+                    });
+                // Register dead argument elimination
+                PB.registerPipelineParsingCallback(
+                    [](StringRef Name, ModulePassManager& MPM,
+                       ArrayRef<PassBuilder::PipelineElement>) {
+                        if (Name == "unit-dead-args") {
+                            MPM.addPass(cs426::UnitDeadArgs());
+                            return true;
+                        }
+                        return false;
+                    });
+                if (UnitDefaultPipeline)
+                    registerExtensionPoints(PB);
             }};
 }
 
@@ -0,0 +1,246 @@
+// Usage: opt -load-pass-plugin=libUnitProject.so -passes="unit-dead-args"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+#include "UnitDeadArgs.h"
+#include "UnitTrace.h"
+
+#define DEBUG_TYPE "UnitDeadArgs"
+// Define any statistics here
+
+using namespace llvm;
+using namespace cs426;
+
+STATISTIC(DConstArg, "Number of arguments found constant");
+STATISTIC(DConstRet, "Number of return values found constant");
+STATISTIC(DArg, "Number of arguments removed");
+STATISTIC(DRet, "Number of return values removed");
+
+PreservedAnalyses UnitDeadArgs::run(Module &M, ModuleAnalysisManager &MAM) {
+  UNIT_TRACE(TracePass,
+             dbgs() << "UnitDeadArgs running on " << M.getName() << "\n");
+  auto &FAM = MAM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+  bool Changed = false;
+  while (runOnce(M, FAM))
+    Changed = true;
+  if (!Changed)
+    return PreservedAnalyses::all();
+  // Calls and returns were replaced in place, no block was touched
+  PreservedAnalyses PA;
+  PA.preserveSet<CFGAnalyses>();
+  return PA;
+}
+/// Substitute the constant arguments and return values the callers' and
+/// callees' solvers agree on, then drop what is left unused
+bool UnitDeadArgs::runOnce(Module &M, FunctionAnalysisManager &FAM) {
+  // Lattice of each argument over its calls, and of each return value
+  map<Function *, vector<LatticeElem>> ArgVal;
+  map<Function *, LatticeElem> RetVal;
+  vector<Function *> Cands;
+  for (auto &F : M) {
+    if (!isCandidate(F))
+      continue;
+    Cands.push_back(&F);
+    ArgVal[&F].resize(F.arg_size());
+    RetVal[&F];
+  }
+  if (Cands.empty())
+    return false;
+  for (auto &G : M) {
+    if (G.isDeclaration())
+      continue;
+    bool IsCand = ArgVal.count(&G);
+    bool Calls = false;
+    for (auto &I : instructions(G)) {
+      auto CB = dyn_cast<CallBase>(&I);
+      if (CB && ArgVal.count(CB->getCalledFunction()))
+        Calls = true;
+    }
+    if (!IsCand && !Calls)
+      continue;
+    Solver.solve(G, FAM.getResult<DominatorTreeAnalysis>(G),
+                 FAM.getResult<TargetLibraryAnalysis>(G));
+    for (auto &BB : G) {
+      if (!Solver.isExecutable(&BB))
+        continue;
+      for (auto &I : BB) {
+        auto RI = dyn_cast<ReturnInst>(&I);
+        if (IsCand && RI && RI->getReturnValue())
+          RetVal[&G].meet(Solver.getLattice(RI->getReturnValue()));
+        auto CB = dyn_cast<CallBase>(&I);
+        if (!CB || !ArgVal.count(CB->getCalledFunction()))
+          continue;
+        auto &Args = ArgVal[CB->getCalledFunction()];
+        for (unsigned i = 0; i < Args.size(); i++)
+          Args[i].meet(Solver.getLattice(CB->getArgOperand(i)));
+      }
+    }
+  }
+  bool Changed = false;
+  PreservedAnalyses PA;
+  PA.preserveSet<CFGAnalyses>();
+  for (auto F : Cands) {
+    auto &Args = ArgVal[F];
+    for (unsigned i = 0; i < Args.size(); i++) {
+      auto A = F->getArg(i);
+      // A byval argument is the callee's own copy, not what calls pass
+      if (!Args[i].isConstant() || A->use_empty() || A->hasByValAttr())
+        continue;
+      A->replaceAllUsesWith(Args[i].get(A->getType()));
+      FAM.invalidate(*F, PA);
+      DConstArg++;
+      Changed = true;
+    }
+    bool HasRet = !F->getReturnType()->isVoidTy();
+    if (HasRet && RetVal[F].isConstant()) {
+      auto C = RetVal[F].get(F->getReturnType());
+      bool Used = false;
+      for (auto U : F->users()) {
+        if (U->use_empty())
+          continue;
+        Used = true;
+        U->replaceAllUsesWith(C);
+        FAM.invalidate(*cast<CallBase>(U)->getFunction(), PA);
+      }
+      DConstRet += Used;
+      Changed |= Used;
+    }
+    vector<bool> KeepArg;
+    bool Drop = false;
+    for (auto &A : F->args()) {
+      KeepArg.push_back(!A.use_empty());
+      Drop |= A.use_empty();
+    }
+    bool KeepRet = false;
+    for (auto U : F->users())
+      KeepRet |= !U->use_empty();
+    Drop |= HasRet && !KeepRet;
+    if (!Drop)
+      continue;
+    rewrite(*F, KeepArg, HasRet && KeepRet, FAM);
+    Changed = true;
+  }
+  return Changed;
+}
+/// An internal function only ever called directly, by calls whose
+/// arguments can be rewritten freely
+bool UnitDeadArgs::isCandidate(Function &F) {
+  if (F.isDeclaration() || !F.hasLocalLinkage() || F.isVarArg() ||
+      F.hasFnAttribute(Attribute::Naked))
+    return false;
+  for (auto &A : F.args())
+    if (A.hasInAllocaAttr() || A.hasPreallocatedAttr() ||
+        A.hasSwiftErrorAttr() || A.hasAttribute(Attribute::SwiftSelf))
+      return false;
+  for (auto &U : F.uses()) {
+    auto CB = dyn_cast<CallBase>(U.getUser());
+    if (!CB || !(isa<CallInst>(CB) || isa<InvokeInst>(CB)) ||
+        !CB->isCallee(&U) || CB->getFunctionType() != F.getFunctionType() ||
+        CB->isMustTailCall())
+      return false;
+  }
+  for (auto &I : instructions(F))
+    if (auto CI = dyn_cast<CallInst>(&I))
+      if (CI->isMustTailCall())
+        return false;
+  return true;
+}
+/// Recreate \p F without the arguments \p KeepArg rules out, returning void
+/// unless \p KeepRet, and redirect every call to the new function
+void UnitDeadArgs::rewrite(Function &F, const vector<bool> &KeepArg,
+                           bool KeepRet, FunctionAnalysisManager &FAM) {
+  auto &Ctx = F.getContext();
+  auto PAL = F.getAttributes();
+  PreservedAnalyses PA;
+  PA.preserveSet<CFGAnalyses>();
+  auto ParamAttrs = [&](AttributeList AL) {
+    SmallVector<AttributeSet, 8> Attrs;
+    for (unsigned i = 0; i < KeepArg.size(); i++) {
+      if (!KeepArg[i])
+        continue;
+      auto AS = AL.getParamAttrs(i);
+      // A void function has nothing for an argument to be returned as
+      if (!KeepRet)
+        AS = AS.removeAttribute(Ctx, Attribute::Returned);
+      Attrs.push_back(AS);
+    }
+    return Attrs;
+  };
+  vector<Type *> Params;
+  for (auto &A : F.args())
+    if (KeepArg[A.getArgNo()])
+      Params.push_back(A.getType());
+  auto RetTy = KeepRet ? F.getReturnType() : Type::getVoidTy(Ctx);
+  auto NF = Function::Create(FunctionType::get(RetTy, Params, false),
+                             F.getLinkage(), F.getAddressSpace());
+  NF->copyAttributesFrom(&F);
+  NF->setComdat(F.getComdat());
+  NF->setAttributes(AttributeList::get(
+      Ctx, PAL.getFnAttrs(), KeepRet ? PAL.getRetAttrs() : AttributeSet(),
+      ParamAttrs(PAL)));
+  NF->copyMetadata(&F, 0);
+  F.getParent()->getFunctionList().insert(F.getIterator(), NF);
+  NF->takeName(&F);
+  UNIT_TRACE(TracePass, dbgs() << "DeadArgs: Rewriting " << NF->getName()
+                               << " to " << *NF->getType() << "\n");
+  DArg += std::count(KeepArg.begin(), KeepArg.end(), false);
+  if (!KeepRet && !F.getReturnType()->isVoidTy())
+    DRet++;
+
+  while (!F.use_empty()) {
+    auto CB = cast<CallBase>(F.user_back());
+    vector<Value *> Args;
+    for (unsigned i = 0; i < KeepArg.size(); i++)
+      if (KeepArg[i])
+        Args.push_back(CB->getArgOperand(i));
+    SmallVector<OperandBundleDef, 1> Bundles;
+    CB->getOperandBundlesAsDefs(Bundles);
+    CallBase *NCB;
+    if (auto II = dyn_cast<InvokeInst>(CB)) {
+      NCB = InvokeInst::Create(NF, II->getNormalDest(), II->getUnwindDest(),
+                               Args, Bundles, "", CB);
+    } else {
+      auto CI = CallInst::Create(NF, Args, Bundles, "", CB);
+      CI->setTailCallKind(cast<CallInst>(CB)->getTailCallKind());
+      NCB = CI;
+    }
+    FAM.invalidate(*CB->getFunction(), PA);
+    auto CPAL = CB->getAttributes();
+    NCB->setCallingConv(CB->getCallingConv());
+    NCB->setAttributes(AttributeList::get(
+        Ctx, CPAL.getFnAttrs(), KeepRet ? CPAL.getRetAttrs() : AttributeSet(),
+        ParamAttrs(CPAL)));
+    NCB->copyMetadata(*CB);
+    if (KeepRet) {
+      CB->replaceAllUsesWith(NCB);
+      NCB->takeName(CB);
+    }
+    CB->eraseFromParent();
+  }
+
+  NF->getBasicBlockList().splice(NF->begin(), F.getBasicBlockList());
+  auto NA = NF->arg_begin();
+  for (auto &A : F.args()) {
+    if (!KeepArg[A.getArgNo()])
+      continue;
+    A.replaceAllUsesWith(&*NA);
+    NA->takeName(&A);
+    ++NA;
+  }
+  if (!KeepRet && !F.getReturnType()->isVoidTy()) {
+    for (auto &BB : *NF) {
+      auto RI = dyn_cast<ReturnInst>(BB.getTerminator());
+      if (!RI)
+        continue;
+      auto RV = RI->getReturnValue();
+      ReturnInst::Create(Ctx, nullptr, RI);
+      RI->eraseFromParent();
+      RecursivelyDeleteTriviallyDeadInstructions(RV);
+    }
+  }
+  FAM.clear(F, F.getName());
+  F.eraseFromParent();
+}
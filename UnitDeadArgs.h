@@ -0,0 +1,28 @@
+#ifndef INCLUDE_UNIT_DEAD_ARGS_H
+#define INCLUDE_UNIT_DEAD_ARGS_H
+#include "UnitSCCP.h"
+#include "llvm/IR/PassManager.h"
+
+using namespace llvm;
+
+namespace cs426 {
+/// Dead argument and return value elimination for internal functions,
+/// driven by SCCP results. The solver of every caller gives the lattice
+/// value each call passes; an argument all executable calls agree on is
+/// replaced by that constant in the callee, and likewise a return value
+/// every executable return agrees on at the call sites. Arguments left
+/// unused and return values no call uses are then dropped from the
+/// signature and from every call. A constant found in one function can
+/// make its callees' values constant in turn, so the pass repeats until
+/// nothing changes.
+struct UnitDeadArgs : PassInfoMixin<UnitDeadArgs> {
+  SCCPSolver Solver;
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &MAM);
+  bool isCandidate(Function &F);
+  bool runOnce(Module &M, FunctionAnalysisManager &FAM);
+  void rewrite(Function &F, const vector<bool> &KeepArg, bool KeepRet,
+               FunctionAnalysisManager &FAM);
+};
+} // namespace cs426
+
+#endif // INCLUDE_UNIT_DEAD_ARGS_H
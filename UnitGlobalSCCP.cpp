@@ -0,0 +1,137 @@
+// Usage: opt -load-pass-plugin=libUnitProject.so -passes="unit-global-sccp"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "UnitGlobalSCCP.h"
+#include "UnitTrace.h"
+
+#define DEBUG_TYPE "UnitGlobalSCCP"
+// Define any statistics here
+
+using namespace llvm;
+using namespace cs426;
+
+STATISTIC(GFold, "Number of internal globals found constant");
+STATISTIC(GLoad, "Number of global loads folded");
+STATISTIC(GStore, "Number of dead global stores deleted");
+
+PreservedAnalyses UnitGlobalSCCP::run(Module &M, ModuleAnalysisManager &MAM) {
+  UNIT_TRACE(TracePass,
+             dbgs() << "UnitGlobalSCCP running on " << M.getName() << "\n");
+  auto &FAM = MAM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+  bool Changed = false;
+  while (runOnce(M, FAM))
+    Changed = true;
+  if (!Changed)
+    return PreservedAnalyses::all();
+  // Only loads, stores and globals were deleted
+  PreservedAnalyses PA;
+  PA.preserveSet<CFGAnalyses>();
+  return PA;
+}
+/// An internal global with a known initial value whose address is only ever
+/// loaded from or stored to, never passed on
+bool UnitGlobalSCCP::isCandidate(GlobalVariable &GV) {
+  if (!GV.hasLocalLinkage() || GV.isConstant() ||
+      !GV.hasDefinitiveInitializer() || GV.isExternallyInitialized() ||
+      !GV.getValueType()->isSingleValueType())
+    return false;
+  for (auto U : GV.users()) {
+    if (auto LI = dyn_cast<LoadInst>(U)) {
+      if (!LI->isSimple() || LI->getType() != GV.getValueType())
+        return false;
+    } else if (auto SI = dyn_cast<StoreInst>(U)) {
+      if (!SI->isSimple() || SI->getValueOperand() == &GV ||
+          SI->getValueOperand()->getType() != GV.getValueType())
+        return false;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+/// Whether no load can see the initial value of \p GV: main stores to it
+/// before calling anything, and main's own loads come after that store.
+/// Other functions only run once main has called them, as there are no
+/// global constructors.
+bool UnitGlobalSCCP::isInitializerDead(GlobalVariable &GV,
+                                       FunctionAnalysisManager &FAM) {
+  auto M = GV.getParent();
+  auto Main = M->getFunction("main");
+  if (!Main || Main->isDeclaration() ||
+      M->getNamedGlobal("llvm.global_ctors"))
+    return false;
+  StoreInst *First = nullptr;
+  for (auto &I : Main->getEntryBlock()) {
+    auto SI = dyn_cast<StoreInst>(&I);
+    if (SI && SI->getPointerOperand() == &GV) {
+      First = SI;
+      break;
+    }
+    if (isa<CallBase>(I) && !isa<IntrinsicInst>(I))
+      return false;
+  }
+  if (!First)
+    return false;
+  auto &DT = FAM.getResult<DominatorTreeAnalysis>(*Main);
+  for (auto U : GV.users()) {
+    auto LI = dyn_cast<LoadInst>(U);
+    if (LI && LI->getFunction() == Main && !DT.dominates(First, LI))
+      return false;
+  }
+  return true;
+}
+/// Fold every candidate global that holds a single value; returns true if
+/// any did
+bool UnitGlobalSCCP::runOnce(Module &M, FunctionAnalysisManager &FAM) {
+  map<GlobalVariable *, LatticeElem> Held;
+  map<Function *, vector<StoreInst *>> Stores;
+  for (auto &GV : M.globals()) {
+    if (!isCandidate(GV))
+      continue;
+    Held[&GV] = isInitializerDead(GV, FAM) ? LatticeElem()
+                                           : LatticeElem(GV.getInitializer());
+    for (auto U : GV.users())
+      if (auto SI = dyn_cast<StoreInst>(U))
+        Stores[SI->getFunction()].push_back(SI);
+  }
+  // Meet in what the executable stores write
+  for (auto &FS : Stores) {
+    auto &F = *FS.first;
+    Solver.solve(F, FAM.getResult<DominatorTreeAnalysis>(F),
+                 FAM.getResult<TargetLibraryAnalysis>(F));
+    for (auto SI : FS.second) {
+      if (!Solver.isExecutable(SI->getParent()))
+        continue;
+      auto GV = cast<GlobalVariable>(SI->getPointerOperand());
+      Held[GV].meet(Solver.getLattice(SI->getValueOperand()));
+    }
+  }
+  bool Changed = false;
+  PreservedAnalyses PA;
+  PA.preserveSet<CFGAnalyses>();
+  for (auto &GVal : Held) {
+    auto GV = GVal.first;
+    if (!GVal.second.isConstant())
+      continue;
+    auto C = GVal.second.get(GV->getValueType());
+    UNIT_TRACE(TracePass, dbgs() << "GlobalSCCP: " << GV->getName()
+                                 << " is always " << *C << "\n");
+    GFold++;
+    Changed = true;
+    while (!GV->use_empty()) {
+      auto I = cast<Instruction>(GV->user_back());
+      if (isa<LoadInst>(I)) {
+        I->replaceAllUsesWith(C);
+        GLoad++;
+      } else {
+        GStore++;
+      }
+      FAM.invalidate(*I->getFunction(), PA);
+      I->eraseFromParent();
+    }
+    GV->eraseFromParent();
+  }
+  return Changed;
+}
@@ -0,0 +1,26 @@
+#ifndef INCLUDE_UNIT_GLOBAL_SCCP_H
+#define INCLUDE_UNIT_GLOBAL_SCCP_H
+#include "UnitSCCP.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/PassManager.h"
+
+using namespace llvm;
+
+namespace cs426 {
+/// Constant propagation through internal global variables. A global whose
+/// address never escapes its loads and stores, and whose initializer and
+/// every executable store agree on one lattice value (the initializer
+/// only counts if some load may observe it), is that constant: its
+/// loads fold and its stores are deleted. Stored values come from the SCCP
+/// solver of the storing function, so folding one global can make the next
+/// one constant; the pass repeats until nothing changes.
+struct UnitGlobalSCCP : PassInfoMixin<UnitGlobalSCCP> {
+  SCCPSolver Solver;
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &MAM);
+  bool isCandidate(GlobalVariable &GV);
+  bool isInitializerDead(GlobalVariable &GV, FunctionAnalysisManager &FAM);
+  bool runOnce(Module &M, FunctionAnalysisManager &FAM);
+};
+} // namespace cs426
+
+#endif // INCLUDE_UNIT_GLOBAL_SCCP_H
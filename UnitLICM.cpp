@@ -1,16 +1,25 @@
 // Usage: opt -load-pass-plugin=libUnitProject.so -passes="unit-licm"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/MemorySSAUpdater.h"
+#include "llvm/Analysis/OptimizationRemarkEmitter.h"
+#include "llvm/Analysis/ScalarEvolution.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/Passes/PassPlugin.h"
 #include "llvm/Support/raw_ostream.h"
+#include <tuple>
 #include <vector>
 
 #include "UnitLICM.h"
+#include "UnitStats.h"
+#include "UnitTrace.h"
 
 #define DEBUG_TYPE "UnitLICM"
+// Remarks go under the pipeline name, as LLVM's own passes' do, so that
+// -pass-remarks=unit-licm selects them
+#define REMARK_PASS "unit-licm"
 #define endl "\n"
 // Define any statistics here
 
@@ -73,12 +82,50 @@ static bool isForUnitProject(Instruction &I) {
   }
   return false;
 }
-bool getAllStore(LoopNode *L, vector<StoreInst *> &Stores) {
+/// Explain why \p I stays in its loop; \p Reason is the one computed in
+/// UnitLICM::run and \p Blocker the store or operand that decided it
+static void remarkMissed(OptimizationRemarkEmitter &ORE, Instruction *I,
+                         int Reason, Value *Blocker) {
+  // Never candidates, so no opportunity was missed
+  if (isa<PHINode>(I) || I->isTerminator() || isa<DbgInfoIntrinsic>(I))
+    return;
+  ORE.emit([&] {
+    switch (Reason) {
+    case 2:
+      return OptimizationRemarkMissed(REMARK_PASS, "UnsupportedOpcode", I)
+             << "not hoisted: " << ore::NV("Opcode", I->getOpcodeName())
+             << " is not an instruction the pass hoists";
+    case 3:
+      return OptimizationRemarkMissed(REMARK_PASS, "NotSpeculatable", I)
+             << "not hoisted: may trap and does not dominate the loop exits";
+    case 4:
+    case 5: {
+      OptimizationRemarkMissed R(REMARK_PASS,
+                                 Reason == 4 ? "LoadClobbered" : "StoreAliased",
+                                 I);
+      R << "not hoisted: " << (Reason == 4 ? "load" : "store");
+      if (Blocker)
+        return R << " may alias "
+                 << ore::NV(isa<StoreInst>(Blocker) ? "Store" : "Read",
+                            Blocker);
+      return R << " in a loop that writes memory other than by stores";
+    }
+    default:
+      return OptimizationRemarkMissed(REMARK_PASS, "VariantOperand", I)
+             << "not hoisted: operand " << ore::NV("Operand", Blocker)
+             << " varies in the loop";
+    }
+  });
+}
+bool getAllStore(LoopNode *L, vector<StoreInst *> &Stores,
+                 vector<Instruction *> &Readers) {
   bool doAA = true;
   for (auto SL : L->Children)
-    doAA &= getAllStore(SL, Stores);
+    doAA &= getAllStore(SL, Stores, Readers);
   for (auto B : L->BlockOfLoop) {
     for (auto &I : *B) {
+      if (I.mayReadFromMemory())
+        Readers.push_back(&I);
       if (I.mayWriteToMemory()) {
         auto S = dyn_cast<StoreInst>(&I);
         // dbgs() << I << endl;
@@ -93,137 +140,236 @@ bool getAllStore(LoopNode *L, vector<StoreInst *> &Stores) {
   return doAA;
 }
 
-/// Main function for running the LICM optimization
-PreservedAnalyses UnitLICM::run(Function &F, FunctionAnalysisManager &FAM) {
-  dbgs() << "UnitLICM running on " << F.getName() << "\n";
-  // Acquires the UnitLoopInfo object constructed by your Loop Identification
-  // (LoopAnalysis) pass
-  UnitLoopInfo &Loops = FAM.getResult<UnitLoopAnalysis>(F);
-  DominatorTree &DT = FAM.getResult<DominatorTreeAnalysis>(F);
-  AAResults &AA = FAM.getResult<AAManager>(F);
+namespace {
+/// One loop as the hoisting fixed point sees it: a LoopNode of UnitLoopInfo
+/// for UnitLICM, an llvm::Loop for UnitLoopLICM
+struct LoopView {
+  /// Blocks of the loop outside its subloops, and its exiting blocks
+  ArrayRef<BasicBlock *> Blocks, Exits;
+  /// Stores anywhere in the loop, subloops included
+  ArrayRef<StoreInst *> Stores;
+  /// Everything that may read memory there, which a hoisted store must not
+  /// write before the first iteration reads it
+  ArrayRef<Instruction *> Readers;
+  /// Whether those stores are all that writes memory in the loop; if not,
+  /// no load or store is hoisted
+  bool OnlyStores;
+  /// Whether a block is in the loop or one of its subloops
+  function_ref<bool(BasicBlock *)> Contains;
+  /// The preheader, made on the first call if the loop has none
+  function_ref<BasicBlock *()> PreHeader;
+};
+} // namespace
 
-  // Perform the optimization
-  // Loops.debug();
-  int wrnm = 0;
+/// Hoist the invariants of \p L into its preheader round by round until
+/// none are left, keeping \p MSSAU up to date if given. Returns whether
+/// anything moved
+static bool hoistLoop(LoopView L, DominatorTree &DT, AAResults &AA,
+                      OptimizationRemarkEmitter &ORE, StatsRecord &Stats,
+                      MemorySSAUpdater *MSSAU) {
+  bool Changed = false;
+  bool Remarks = ORE.allowExtraAnalysis(REMARK_PASS);
   auto MyAlias = [&](const Value *S, const Value *LL) {
     // if((S==L)!=(AA.alias(S, LL) != AliasResult::NoAlias))
     // return S == LL;
     // dbgs() << AA.alias(S, LL) << endl;
     // return AA.alias(S, LL) == AliasResult::PartialAlias ||
     //  AA.alias(S, LL) == AliasResult::MustAlias;
+    StatsRecord::Phase P(Stats, "alias");
+    Stats.count("aa_queries");
     return AA.alias(S, LL) != AliasResult::NoAlias;
   };
-  for (auto OL : Loops.OutmostLoops) {
-    OL->debug("Outmost");
-    vector<LoopNode *> SubLoops;
-    getTraverseOrder(OL, SubLoops);
-    dbgs() << SubLoops.size() << "\n";
-    for (auto L : SubLoops) {
-      // L->debug("Subloop");
-      vector<StoreInst *> Stores;
-      bool doAA = getAllStore(L, Stores) | true;
-      // bool doAA = false;
-
-      for (bool NewMark = true; NewMark;) {
-        NewMark = false;
-        map<Instruction *, bool> IsInvariantBlock;
-        vector<Instruction *> MovingInstr;
-        for (auto B : L->BlockOfLoop) {
-          for (auto &I : *B) {
-            bool isInvariant = true; // I is Invariant
-            int reason = [&] {
-              if (!isForUnitProject(I))
-                return 2;
-              auto LL = dyn_cast<LoadInst>(&I);
-              if (LL && ![&] {
-                    // is safe for hoist
-                    if (!doAA)
-                      return false;
-                    for (auto S : Stores) {
-                      if (MyAlias(S->getPointerOperand(),
-                                  LL->getPointerOperand())) {
-                        dbgs() << "May Alias " << *S << " With" << *LL << "\n";
-                        return false;
-                      } else {
-                        dbgs() << "No Alias " << *S << " With" << *LL << "\n";
-                      }
-                    }
-                    return true;
-                  }())
-                return 4;
-              auto SS = dyn_cast<StoreInst>(&I);
-              if (SS && ![&] {
-                    // is safe for hoist
-                    if (!doAA)
+  auto MyModRef = [&](Instruction *R, const MemoryLocation &Loc) {
+    StatsRecord::Phase P(Stats, "alias");
+    Stats.count("aa_queries");
+    return isModOrRefSet(AA.getModRefInfo(R, Loc));
+  };
+  auto &Stores = L.Stores;
+  bool doAA = L.OnlyStores;
+  // Instructions the last round kept in the loop, why, and the blocker
+  vector<std::tuple<Instruction *, int, Value *>> Missed;
+
+  for (bool NewMark = true; NewMark;) {
+    NewMark = false;
+    Missed.clear();
+    StatsRecord::Phase Round(Stats, "fixpoint");
+    Stats.count("rounds");
+    map<Instruction *, bool> IsInvariantBlock;
+    vector<Instruction *> MovingInstr;
+    for (auto B : L.Blocks) {
+      for (auto &I : *B) {
+        bool isInvariant = true; // I is Invariant
+        Value *Blocker = nullptr;
+        int reason = [&] {
+          if (!isForUnitProject(I))
+            return 2;
+          auto LL = dyn_cast<LoadInst>(&I);
+          if (LL && ![&] {
+                // is safe for hoist
+                if (!doAA)
+                  return false;
+                for (auto S : Stores) {
+                  if (MyAlias(S->getPointerOperand(),
+                              LL->getPointerOperand())) {
+                    UNIT_TRACE(TraceVisit, dbgs() << "May Alias " << *S
+                                                  << " With" << *LL
+                                                  << "\n");
+                    Blocker = S;
+                    return false;
+                  } else {
+                    UNIT_TRACE(TraceVisit, dbgs() << "No Alias " << *S
+                                                  << " With" << *LL
+                                                  << "\n");
+                  }
+                }
+                return true;
+              }())
+            return 4;
+          auto SS = dyn_cast<StoreInst>(&I);
+          if (SS && ![&] {
+                // is safe for hoist
+                if (!doAA)
+                  return false;
+                for (auto S : Stores) {
+                  if (S != SS)
+                    if (MyAlias(S->getPointerOperand(),
+                                SS->getPointerOperand())) {
+                      UNIT_TRACE(TraceVisit, dbgs() << "May Alias " << *S
+                                                    << " With" << *SS
+                                                    << "\n");
+                      Blocker = S;
                       return false;
-                    for (auto S : Stores) {
-                      if (S != SS)
-                        if (MyAlias(S->getPointerOperand(),
-                                    SS->getPointerOperand())) {
-                          dbgs()
-                              << "May Alias " << *S << " With" << *SS << "\n";
-                          return false;
-                        } else {
-                          dbgs() << "No Alias " << *S << " With" << *SS << "\n";
-                        }
-                    }
-                    return true;
-                  }())
-                return 5;
-              if (ifDominateAll(DT, B, L->Exits))
-                return -1;
-              // [x] isSafeToSpeculativelyExecute
-              if (!isSafeToSpeculativelyExecute(&I))
-                return 3;
-              // [x] isnoalias
-              return 0;
-            }();
-
-            if (reason <= 0) { // check instruction validity
-              for (auto &U : I.operands()) {
-                // U is operand of I
-                auto V = U.get();
-                auto Inst = dyn_cast<Instruction>(V);
-                if (Inst) {
-                  // Inst is def of operand U
-                  auto InstBlock = Inst->getParent();
-                  if (Loops.getLoopFor(InstBlock)->isInnerLoopOf(L))
-                    if (!IsInvariantBlock[Inst]) {
-                      reason = 6;
-                      break;
+                    } else {
+                      UNIT_TRACE(TraceVisit, dbgs() << "No Alias " << *S
+                                                    << " With" << *SS
+                                                    << "\n");
                     }
                 }
-              }
-            }
-            if (reason <= 0) {
-              dbgs() << "True Invariant Reason " << reason << I << "\n";
-            } else {
-              dbgs() << "Not Invariant Reason " << reason << I << "\n";
-              isInvariant = false;
-            }
+                auto Loc = MemoryLocation::get(SS);
+                for (auto R : L.Readers) {
+                  if (R != SS && MyModRef(R, Loc)) {
+                    UNIT_TRACE(TraceVisit, dbgs() << "May Read " << *R
+                                                  << " With" << *SS
+                                                  << "\n");
+                    Blocker = R;
+                    return false;
+                  }
+                }
+                return true;
+              }())
+            return 5;
+          if (ifDominateAll(DT, B, L.Exits))
+            return -1;
+          // [x] isSafeToSpeculativelyExecute
+          if (!isSafeToSpeculativelyExecute(&I))
+            return 3;
+          // [x] isnoalias
+          return 0;
+        }();
 
-            if (isInvariant) {
-              // dbgs() << "Invariant " << I << "\n";
-              IsInvariantBlock[&I] = true;
-              MovingInstr.push_back(&I);
-            }
-          }
-        };
-
-        for (auto I : MovingInstr) {
-          // if (!I->isCast())
-          if (auto PreHeader = L->getPreHeader()) {
-            if (wrnm-- < 1) {
-              auto InsertPtr = PreHeader->getTerminator();
-              dbgs() << "Invariant " << *I << " Move before " << *InsertPtr
-                     << "\n";
-              countStat(*I);
-              I->moveBefore(InsertPtr);
-              NewMark = true;
+        if (reason <= 0) { // check instruction validity
+          for (auto &U : I.operands()) {
+            // U is operand of I
+            auto V = U.get();
+            auto Inst = dyn_cast<Instruction>(V);
+            if (Inst) {
+              // Inst is def of operand U
+              if (L.Contains(Inst->getParent()))
+                if (!IsInvariantBlock[Inst]) {
+                  reason = 6;
+                  Blocker = Inst;
+                  break;
+                }
             }
           }
         }
+        if (reason <= 0) {
+          UNIT_TRACE(TraceDecision, dbgs() << "True Invariant Reason "
+                                           << reason << I << "\n");
+        } else {
+          UNIT_TRACE(TraceDecision, dbgs() << "Not Invariant Reason "
+                                           << reason << I << "\n");
+          isInvariant = false;
+          if (Remarks)
+            Missed.emplace_back(&I, reason, Blocker);
+        }
+
+        if (isInvariant) {
+          // dbgs() << "Invariant " << I << "\n";
+          IsInvariantBlock[&I] = true;
+          MovingInstr.push_back(&I);
+        }
+      }
+    };
+
+    for (auto I : MovingInstr) {
+      // if (!I->isCast())
+      BasicBlock *PreHeader;
+      {
+        StatsRecord::Phase P(Stats, "preheader");
+        PreHeader = L.PreHeader();
       }
+      if (PreHeader) {
+        auto InsertPtr = PreHeader->getTerminator();
+        UNIT_TRACE(TracePass, dbgs() << "Invariant " << *I
+                                     << " Move before " << *InsertPtr
+                                     << "\n");
+        countStat(*I);
+        Stats.count("hoisted");
+        I->moveBefore(InsertPtr);
+        if (MSSAU)
+          if (auto MA = MSSAU->getMemorySSA()->getMemoryAccess(I))
+            MSSAU->moveToPlace(MA, PreHeader, MemorySSA::BeforeTerminator);
+        NewMark = Changed = true;
+        ORE.emit([&] {
+          return OptimizationRemark(REMARK_PASS, "Hoisted", I)
+                 << "hoisted " << ore::NV("Inst", I) << " to "
+                 << ore::NV("Preheader", getSimpleNodeLabel(PreHeader));
+        });
+      }
+    }
+  }
+  for (auto &M : Missed)
+    remarkMissed(ORE, std::get<0>(M), std::get<1>(M), std::get<2>(M));
+  return Changed;
+}
+
+/// Main function for running the LICM optimization
+PreservedAnalyses UnitLICM::run(Function &F, FunctionAnalysisManager &FAM) {
+  UNIT_TRACE(TracePass,
+             dbgs() << "UnitLICM running on " << F.getName() << "\n");
+  // Acquires the UnitLoopInfo object constructed by your Loop Identification
+  // (LoopAnalysis) pass
+  StatsRecord Stats("UnitLICM", F);
+  UnitLoopInfo *LoopsP;
+  {
+    StatsRecord::Phase P(Stats, "loops");
+    LoopsP = &FAM.getResult<UnitLoopAnalysis>(F);
+  }
+  UnitLoopInfo &Loops = *LoopsP;
+  DominatorTree &DT = FAM.getResult<DominatorTreeAnalysis>(F);
+  AAResults &AA = FAM.getResult<AAManager>(F);
+  auto &ORE = FAM.getResult<OptimizationRemarkEmitterAnalysis>(F);
+
+  // Perform the optimization
+  // Loops.debug();
+  for (auto OL : Loops.OutmostLoops) {
+    UNIT_TRACE(TraceDecision, OL->debug("Outmost"));
+    vector<LoopNode *> SubLoops;
+    getTraverseOrder(OL, SubLoops);
+    for (auto L : SubLoops) {
+      // L->debug("Subloop");
+      vector<StoreInst *> Stores;
+      vector<Instruction *> Readers;
+      bool OnlyStores = getAllStore(L, Stores, Readers);
+      auto Contains = [&](BasicBlock *B) {
+        auto N = Loops.getLoopFor(B);
+        return N && N->isInnerLoopOf(L);
+      };
+      auto PreHeader = [&] { return L->getPreHeader(); };
+      hoistLoop({L->BlockOfLoop, L->Exits, Stores, Readers, OnlyStores,
+                 Contains, PreHeader},
+                DT, AA, ORE, Stats, nullptr);
     }
   }
 
@@ -236,4 +382,52 @@ PreservedAnalyses UnitLICM::run(Function &F, FunctionAnalysisManager &FAM) {
   // return PreservedAnalyses::all();
 }
 
-#undef endl
\ No newline at end of file
+/// The same fixed point on one loop of a loop pass manager, which keeps the
+/// loop simplified so a preheader is always there
+PreservedAnalyses UnitLoopLICM::run(Loop &L, LoopAnalysisManager &AM,
+                                    LoopStandardAnalysisResults &AR,
+                                    LPMUpdater &) {
+  Function &F = *L.getHeader()->getParent();
+  UNIT_TRACE(TracePass, dbgs() << "UnitLoopLICM running on " << L.getName()
+                               << " in " << F.getName() << "\n");
+  StatsRecord Stats("UnitLoopLICM", F);
+  // Not cached under a loop pass manager; built directly as LLVM's licm does
+  OptimizationRemarkEmitter ORE(&F);
+  vector<BasicBlock *> Blocks;
+  vector<StoreInst *> Stores;
+  vector<Instruction *> Readers;
+  bool OnlyStores = true;
+  for (auto BB : L.blocks()) {
+    if (AR.LI.getLoopFor(BB) == &L)
+      Blocks.push_back(BB);
+    for (auto &I : *BB) {
+      if (I.mayReadFromMemory())
+        Readers.push_back(&I);
+      if (!I.mayWriteToMemory())
+        continue;
+      if (auto S = dyn_cast<StoreInst>(&I))
+        Stores.push_back(S);
+      else
+        OnlyStores = false;
+    }
+  }
+  SmallVector<BasicBlock *, 4> Exits;
+  L.getExitingBlocks(Exits);
+  auto Contains = [&](BasicBlock *B) { return L.contains(B); };
+  auto PreHeader = [&] { return L.getLoopPreheader(); };
+  Optional<MemorySSAUpdater> MSSAU;
+  if (AR.MSSA)
+    MSSAU.emplace(AR.MSSA);
+  if (!hoistLoop({Blocks, Exits, Stores, Readers, OnlyStores, Contains,
+                  PreHeader},
+                 AR.DT, AR.AA, ORE, Stats,
+                 MSSAU ? MSSAU.getPointer() : nullptr))
+    return PreservedAnalyses::all();
+  AR.SE.forgetLoopDispositions(&L);
+  auto PA = getLoopPassPreservedAnalyses();
+  if (AR.MSSA)
+    PA.preserve<MemorySSAAnalysis>();
+  return PA;
+}
+
+#undef endl
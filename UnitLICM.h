@@ -1,6 +1,7 @@
 #ifndef INCLUDE_UNIT_LICM_H
 #define INCLUDE_UNIT_LICM_H
 #include "llvm/IR/PassManager.h"
+#include "llvm/Transforms/Scalar/LoopPassManager.h"
 #include "UnitLoopInfo.h"
 
 using namespace llvm;
@@ -11,6 +12,13 @@ namespace cs426 {
 struct UnitLICM : PassInfoMixin<UnitLICM> {
   PreservedAnalyses run(Function& F, FunctionAnalysisManager& FAM);
 };
+
+/// UnitLICM as a loop pass, to share a loop pass manager and its analyses
+/// with LLVM's loop passes; loops are visited innermost first
+struct UnitLoopLICM : PassInfoMixin<UnitLoopLICM> {
+  PreservedAnalyses run(Loop& L, LoopAnalysisManager& AM,
+                        LoopStandardAnalysisResults& AR, LPMUpdater& U);
+};
 } // namespace
 
 #endif // INCLUDE_UNIT_LICM_H
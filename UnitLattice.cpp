@@ -0,0 +1,326 @@
+#include "llvm/ADT/APSInt.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/IR/Instructions.h"
+
+#include "UnitLattice.h"
+
+using namespace llvm;
+using namespace cs426;
+
+LatticeElem::LatticeElem(Constant *C) : Status(constant), Val(nullptr) {
+  assert(C);
+  if (isa<UndefValue>(C))
+    Status = undef;
+  if (auto CI = dyn_cast<ConstantInt>(C))
+    Int = CI->getValue();
+  else if (auto CF = dyn_cast<ConstantFP>(C))
+    FP = CF->getValueAPF();
+  else
+    Val = C;
+}
+LatticeElem LatticeElem::fromElems(std::vector<LatticeElem> Elems, Type *Ty) {
+  bool AllConstant = true, AllBottom = true;
+  for (auto &E : Elems) {
+    AllConstant &= E.isConstant() || E.isUndef();
+    AllBottom &= E.isBottom() && !E.isPartial();
+  }
+  if (AllConstant) {
+    std::vector<Constant *> Cs;
+    for (unsigned i = 0, n = Elems.size(); i < n; i++)
+      Cs.push_back(Elems[i].get(getElemType(Ty, i)));
+    if (auto STy = dyn_cast<StructType>(Ty))
+      return ConstantStruct::get(STy, Cs);
+    if (auto ATy = dyn_cast<ArrayType>(Ty))
+      return ConstantArray::get(ATy, Cs);
+    return ConstantVector::get(Cs);
+  }
+  if (AllBottom)
+    return bottom;
+  LatticeElem Res(bottom);
+  Res.Elems = std::move(Elems);
+  return Res;
+}
+Type *LatticeElem::getElemType(Type *Ty, unsigned i) {
+  if (auto STy = dyn_cast<StructType>(Ty))
+    return STy->getElementType(i);
+  if (auto ATy = dyn_cast<ArrayType>(Ty))
+    return ATy->getElementType();
+  return cast<VectorType>(Ty)->getElementType();
+}
+unsigned LatticeElem::numElems() const {
+  if (isPartial())
+    return Elems.size();
+  if (!Val || (!isConstant() && !isUndef()))
+    return 0;
+  auto Ty = Val->getType();
+  if (auto VTy = dyn_cast<FixedVectorType>(Ty))
+    return VTy->getNumElements();
+  if (auto STy = dyn_cast<StructType>(Ty))
+    return STy->getNumElements();
+  if (auto ATy = dyn_cast<ArrayType>(Ty))
+    return ATy->getNumElements();
+  return 0;
+}
+LatticeElem LatticeElem::getElem(unsigned i) const {
+  if (isPartial())
+    return Elems[i];
+  if (!isConstant() && !isUndef())
+    return Status;
+  if (auto C = Val->getAggregateElement(i))
+    return C;
+  return bottom;
+}
+bool LatticeElem::meetElems(const LatticeElem &R) {
+  std::vector<LatticeElem> Mine;
+  for (unsigned i = 0, n = numElems(); i < n; i++)
+    Mine.push_back(getElem(i));
+  bool Changed = !isPartial(), AllBottom = true;
+  for (unsigned i = 0, n = Mine.size(); i < n; i++) {
+    auto RE = R.getElem(i);
+    if (!RE.isTop() || !Mine[i].isTop())
+      Changed |= Mine[i].meet(RE);
+    AllBottom &= Mine[i].isBottom() && !Mine[i].isPartial();
+  }
+  if (AllBottom)
+    return markBottom() || Changed;
+  // Two constants whose undef elements fill in for each other stay constant
+  auto Ty = Val ? Val->getType() : nullptr;
+  if (isConstant() && Ty) {
+    auto Res = fromElems(Mine, Ty);
+    if (Res.isConstant()) {
+      Changed = !sameValue(Res);
+      *this = Res;
+      return Changed;
+    }
+  }
+  Status = bottom;
+  Val = nullptr;
+  FP.reset();
+  Elems = std::move(Mine);
+  return Changed;
+}
+Constant *LatticeElem::get(Type *Ty) const {
+  assert(isConstant() || isUndef());
+  if (Val)
+    return Val;
+  if (FP)
+    return ConstantFP::get(Ty->getContext(), *FP);
+  return ConstantInt::get(Ty, Int);
+}
+bool LatticeElem::isNullValue() const {
+  if (Val)
+    return Val->isNullValue();
+  if (FP)
+    return FP->isPosZero();
+  return Int.isZero();
+}
+bool LatticeElem::isAllOnesValue() const {
+  if (Val)
+    return Val->isAllOnesValue();
+  if (FP)
+    return FP->bitcastToAPInt().isAllOnes();
+  return Int.isAllOnes();
+}
+bool LatticeElem::sameValue(const LatticeElem &R) const {
+  // Constants are uniqued; element-wise equality would let undef lanes
+  // match anything
+  if (Val || R.Val)
+    return Val == R.Val;
+  if (FP || R.FP)
+    return FP && R.FP && FP->bitwiseIsEqual(*R.FP);
+  return Int.getBitWidth() == R.Int.getBitWidth() && Int == R.Int;
+}
+
+static Optional<APInt> foldIntBinary(unsigned Opcode, const APInt &L,
+                                     const APInt &R) {
+  switch (Opcode) {
+  case Instruction::Add:
+    return L + R;
+  case Instruction::Sub:
+    return L - R;
+  case Instruction::Mul:
+    return L * R;
+  case Instruction::UDiv:
+    if (R.isZero())
+      return None;
+    return L.udiv(R);
+  case Instruction::URem:
+    if (R.isZero())
+      return None;
+    return L.urem(R);
+  case Instruction::SDiv:
+    if (R.isZero() || (R.isAllOnes() && L.isMinSignedValue()))
+      return None;
+    return L.sdiv(R);
+  case Instruction::SRem:
+    if (R.isZero() || (R.isAllOnes() && L.isMinSignedValue()))
+      return None;
+    return L.srem(R);
+  case Instruction::Shl:
+    if (R.uge(L.getBitWidth()))
+      return None;
+    return L.shl(R);
+  case Instruction::LShr:
+    if (R.uge(L.getBitWidth()))
+      return None;
+    return L.lshr(R);
+  case Instruction::AShr:
+    if (R.uge(L.getBitWidth()))
+      return None;
+    return L.ashr(R);
+  case Instruction::And:
+    return L & R;
+  case Instruction::Or:
+    return L | R;
+  case Instruction::Xor:
+    return L ^ R;
+  }
+  return None;
+}
+bool cs426::foldBinary(unsigned Opcode, const LatticeElem &L,
+                       const LatticeElem &R, LatticeElem &Res) {
+  if (L.isInt() && R.isInt()) {
+    if (auto V = foldIntBinary(Opcode, L.Int, R.Int)) {
+      Res = *V;
+      return true;
+    }
+    return false;
+  }
+  if (!L.isFP() || !R.isFP())
+    return false;
+  APFloat V = *L.FP;
+  switch (Opcode) {
+  case Instruction::FAdd:
+    V.add(*R.FP, APFloat::rmNearestTiesToEven);
+    break;
+  case Instruction::FSub:
+    V.subtract(*R.FP, APFloat::rmNearestTiesToEven);
+    break;
+  case Instruction::FMul:
+    V.multiply(*R.FP, APFloat::rmNearestTiesToEven);
+    break;
+  case Instruction::FDiv:
+    V.divide(*R.FP, APFloat::rmNearestTiesToEven);
+    break;
+  case Instruction::FRem:
+    V.mod(*R.FP);
+    break;
+  default:
+    return false;
+  }
+  Res = V;
+  return true;
+}
+bool cs426::foldUnary(unsigned Opcode, const LatticeElem &V,
+                      LatticeElem &Res) {
+  if (Opcode != Instruction::FNeg || !V.isFP())
+    return false;
+  Res = neg(*V.FP);
+  return true;
+}
+bool cs426::foldCast(unsigned Opcode, const LatticeElem &V, Type *DestTy,
+                     LatticeElem &Res) {
+  if (DestTy->isVectorTy() || (!V.isInt() && !V.isFP()))
+    return false;
+  bool Ignored;
+  switch (Opcode) {
+  case Instruction::Trunc:
+    Res = V.Int.trunc(DestTy->getIntegerBitWidth());
+    return true;
+  case Instruction::ZExt:
+    Res = V.Int.zext(DestTy->getIntegerBitWidth());
+    return true;
+  case Instruction::SExt:
+    Res = V.Int.sext(DestTy->getIntegerBitWidth());
+    return true;
+  case Instruction::FPTrunc:
+  case Instruction::FPExt: {
+    APFloat F = *V.FP;
+    F.convert(DestTy->getFltSemantics(), APFloat::rmNearestTiesToEven,
+              &Ignored);
+    Res = F;
+    return true;
+  }
+  case Instruction::FPToUI:
+  case Instruction::FPToSI: {
+    APSInt IntVal(DestTy->getIntegerBitWidth(),
+                  Opcode == Instruction::FPToUI);
+    if (V.FP->convertToInteger(IntVal, APFloat::rmTowardZero, &Ignored) &
+        APFloat::opInvalidOp)
+      return false;
+    Res = APInt(IntVal);
+    return true;
+  }
+  case Instruction::UIToFP:
+  case Instruction::SIToFP: {
+    APFloat F = APFloat::getZero(DestTy->getFltSemantics());
+    F.convertFromAPInt(V.Int, Opcode == Instruction::SIToFP,
+                       APFloat::rmNearestTiesToEven);
+    Res = F;
+    return true;
+  }
+  case Instruction::BitCast:
+    if (V.isInt() && DestTy->isFloatingPointTy()) {
+      Res = APFloat(DestTy->getFltSemantics(), V.Int);
+      return true;
+    }
+    if (V.isFP() && DestTy->isIntegerTy()) {
+      Res = V.FP->bitcastToAPInt();
+      return true;
+    }
+    return false;
+  }
+  return false;
+}
+bool cs426::foldCmp(unsigned Predicate, const LatticeElem &L,
+                    const LatticeElem &R, LatticeElem &Res) {
+  auto Pred = CmpInst::Predicate(Predicate);
+  if (L.isInt() && R.isInt() && CmpInst::isIntPredicate(Pred)) {
+    Res = APInt(1, ICmpInst::compare(L.Int, R.Int, Pred));
+    return true;
+  }
+  if (L.isFP() && R.isFP() && CmpInst::isFPPredicate(Pred)) {
+    Res = APInt(1, FCmpInst::compare(*L.FP, *R.FP, Pred));
+    return true;
+  }
+  return false;
+}
+string LatticeElem::getStatus(const LatticeStatus L) {
+  switch (L) {
+  case constant:
+    return "Constant";
+  case top:
+    return "Top (may be constant)";
+  case undef:
+    return "Undef (may be any constant)";
+  case bottom:
+    return "Bottom (cannot be constant)";
+  }
+  return "?";
+}
+string LatticeElem::info() {
+  string str;
+  raw_string_ostream os(str);
+  os << getStatus(Status);
+  if (isPartial()) {
+    os << " elements [";
+    for (unsigned i = 0, n = Elems.size(); i < n; i++)
+      os << (i ? ", " : "") << Elems[i].info();
+    os << "]";
+  }
+  if (isConstant()) {
+    os << " (";
+    if (Val) {
+      os << *Val;
+    } else if (FP) {
+      SmallString<16> S;
+      FP->toString(S);
+      os << S;
+    } else {
+      os << "i" << Int.getBitWidth() << " ";
+      Int.print(os, true);
+    }
+    os << ")";
+  }
+  return str;
+}
@@ -0,0 +1,127 @@
+#ifndef INCLUDE_UNIT_LATTICE_H
+#define INCLUDE_UNIT_LATTICE_H
+#include "llvm/ADT/APFloat.h"
+#include "llvm/ADT/APInt.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/Support/raw_ostream.h"
+#include <string>
+#include <vector>
+
+using namespace llvm;
+using std::string;
+
+namespace cs426 {
+enum LatticeStatus {
+  top,   // may be constant
+  undef, // undef or poison, which meets any constant as that constant
+  constant,
+  bottom // cannot be constant
+};
+
+/// Lattice value of the constant propagation. Scalar integer and floating
+/// point constants are carried as APInt/APFloat, so solving does not intern a
+/// Constant in the LLVMContext for every intermediate value; only get()
+/// materializes one. Everything else (pointers, vectors, aggregates) is held
+/// as a Constant, and so is the undef or poison value of the undef state.
+struct LatticeElem {
+  LatticeStatus Status;
+  Constant *Val;        // constant that is neither an integer nor an FP scalar
+  APInt Int;            // valid if isInt()
+  Optional<APFloat> FP; // valid if isFP()
+  // Per-lane lattice of a fixed-width vector, or per-field lattice of a
+  // struct or array, that is bottom as a whole but has some constant
+  // elements; empty otherwise
+  std::vector<LatticeElem> Elems;
+  LatticeElem() : Status(top), Val(nullptr) {}
+  LatticeElem(Constant *C);
+  LatticeElem(const APInt &V) : Status(constant), Val(nullptr), Int(V) {}
+  LatticeElem(const APFloat &V) : Status(constant), Val(nullptr), FP(V) {}
+  LatticeElem(LatticeStatus Status) : Status(Status), Val(nullptr) {}
+  /// Lattice of a vector or aggregate of type \p Ty made of \p Elems
+  static LatticeElem fromElems(std::vector<LatticeElem> Elems, Type *Ty);
+  /// Type of element \p i of the vector or aggregate type \p Ty
+  static Type *getElemType(Type *Ty, unsigned i);
+  bool isTop() const { return Status == top; }
+  bool isUndef() const { return Status == undef; }
+  bool isConstant() const { return Status == constant; }
+  bool isBottom() const { return Status == bottom; }
+  bool isPartial() const { return isBottom() && !Elems.empty(); }
+  bool isInt() const { return isConstant() && !Val && !FP; }
+  bool isFP() const { return isConstant() && FP.hasValue(); }
+  /// Materialize the constant, or the undef value, as a value of type \p Ty
+  Constant *get(Type *Ty) const;
+  bool isNullValue() const;
+  bool isAllOnesValue() const;
+  bool sameValue(const LatticeElem &R) const;
+  /// Number of elements if this is a fixed-width vector or aggregate
+  /// constant, or partial
+  unsigned numElems() const;
+  LatticeElem getElem(unsigned i) const;
+  LatticeElem operator^(const LatticeElem &R) {
+    assert(Status != top || R.Status != top);
+    LatticeElem Res = *this;
+    Res.meet(R);
+    return Res;
+  }
+  bool markBottom() {
+    if (isBottom() && Elems.empty())
+      return false;
+    Status = bottom;
+    Val = nullptr;
+    FP.reset();
+    Elems.clear();
+    return true;
+  }
+  bool meet(const LatticeElem &R) {
+    assert(Status != top || R.Status != top);
+    if (R.Status == top)
+      return false;
+    // Undef may be refined to any value, so it only ever gives way
+    if (R.Status == undef) {
+      if (Status != top)
+        return false;
+      *this = R;
+      return true;
+    }
+    if (Status == top || Status == undef) {
+      *this = R;
+      return true;
+    }
+    if (isConstant() && R.isConstant() && sameValue(R))
+      return false;
+    // Vectors and aggregates keep the elements both sides agree on
+    unsigned N = numElems();
+    if (N && N == R.numElems())
+      return meetElems(R);
+    return markBottom();
+  }
+  bool meetElems(const LatticeElem &R);
+  string getStatus(const LatticeStatus L);
+  string info();
+};
+
+/// Nullness of a pointer value. Default constructed cells are top; any two
+/// different facts meet in MaybeNull.
+enum Nullness { NullTop, KnownNull, KnownNonNull, MaybeNull };
+inline Nullness meetNull(Nullness A, Nullness B) {
+  if (A == NullTop)
+    return B;
+  if (B == NullTop || A == B)
+    return A;
+  return MaybeNull;
+}
+
+// Evaluation on APInt/APFloat lattice constants. Each returns false if the
+// operands are not scalars it handles or the result would be poison; callers
+// then fall back to the Constant folder.
+bool foldBinary(unsigned Opcode, const LatticeElem &L, const LatticeElem &R,
+                LatticeElem &Res);
+bool foldUnary(unsigned Opcode, const LatticeElem &V, LatticeElem &Res);
+bool foldCast(unsigned Opcode, const LatticeElem &V, Type *DestTy,
+              LatticeElem &Res);
+bool foldCmp(unsigned Predicate, const LatticeElem &L, const LatticeElem &R,
+             LatticeElem &Res);
+} // namespace cs426
+
+#endif // INCLUDE_UNIT_LATTICE_H
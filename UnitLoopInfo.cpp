@@ -4,20 +4,26 @@
 #include "llvm/Support/raw_ostream.h"
 
 #include "UnitLoopInfo.h"
+#include "UnitStats.h"
+#include "UnitTrace.h"
 
 using namespace llvm;
 using namespace cs426;
 
+#define DEBUG_TYPE "UnitLoopInfo"
+
 /// Main function for running the Loop Identification analysis. This function
 /// returns information about the loops in the function via the UnitLoopInfo
 /// object
 
 UnitLoopInfo UnitLoopAnalysis::run(Function &F, FunctionAnalysisManager &FAM) {
-  dbgs() << "UnitLoopAnalysis running on " << F.getName() << "\n";
+  UNIT_TRACE(TracePass,
+             dbgs() << "UnitLoopAnalysis running on " << F.getName() << "\n");
   // Acquires the Dominator Tree constructed by LLVM for this function. You may
   // find this useful in identifying the natural loops
   DominatorTree &DT = FAM.getResult<DominatorTreeAnalysis>(F);
 
+  StatsRecord Stats("UnitLoopAnalysis", F);
   UnitLoopInfo Loops;
   // Fill in appropriate information
   auto Rt = DT.getRootNode();
@@ -25,16 +31,25 @@ UnitLoopInfo UnitLoopAnalysis::run(Function &F, FunctionAnalysisManager &FAM) {
     auto D = Node->getBlock(); // header
     BasicBlocks BackEdges;
     for (auto N : predecessors(D)) {
-      if (DT.dominates(D, N)) {
+      // Unreachable blocks are dominated by everything
+      if (DT.isReachableFromEntry(N) && DT.dominates(D, N)) {
         // dbgs() << "potential back edges:" << getSimpleNodeLabel(N) << "->"
         //        << getSimpleNodeLabel(D) << "\n";
         BackEdges.push_back(N);
       }
     }
-    if (!BackEdges.empty())
+    if (BackEdges.empty())
+      continue;
+    {
+      StatsRecord::Phase P(Stats, "discover");
       Loops.addLoopInfo(D, BackEdges, DT);
+    }
+    // Before the next header: its exits depend on the loops nested so far
+    StatsRecord::Phase P(Stats, "exits");
+    Loops.computeExits(Loops.AllLoops.back());
   }
   Loops.discoverOutmostLoops();
+  Stats.count("loops", Loops.AllLoops.size());
   return Loops;
 }
 
@@ -62,7 +77,7 @@ void UnitLoopInfo::addLoopInfo(BasicBlock *Header, BasicBlocks &BackEdges,
       CurLoop->Children.push_back(L);
       L->setParent(CurLoop);
       for (auto tmp : predecessors(L->Header)) { // safe?
-        if (getLoopFor(tmp) != CurLoop)
+        if (getLoopFor(tmp) != CurLoop && DT.isReachableFromEntry(tmp))
           Q.push(tmp);
       }
     } else {
@@ -72,13 +87,17 @@ void UnitLoopInfo::addLoopInfo(BasicBlock *Header, BasicBlocks &BackEdges,
       if (u == Header)
         continue;
       for (auto tmp : predecessors(u)) {
-        if (getLoopFor(tmp) != CurLoop)
+        if (getLoopFor(tmp) != CurLoop && DT.isReachableFromEntry(tmp))
           Q.push(tmp);
       }
     }
   }
   reverse(CurLoop->BlockOfLoop.begin(), CurLoop->BlockOfLoop.end());
   reverse(CurLoop->Children.begin(), CurLoop->Children.end());
+}
+
+void UnitLoopInfo::computeExits(LoopNode *CurLoop) {
+  auto Header = CurLoop->Header;
   for (auto B : CurLoop->BlockOfLoop) {
     for (auto C : successors(B)) {
       auto L = getLoopFor(C);
@@ -104,7 +123,7 @@ void UnitLoopInfo::addLoopInfo(BasicBlock *Header, BasicBlocks &BackEdges,
       CurLoop->Enters.push_back(C);
     }
   }
-  CurLoop->debug();
+  UNIT_TRACE(TraceDecision, CurLoop->debug());
   // int cnt = 0;
   // BasicBlock *PreHeader = nullptr;
   // for (auto p : predecessors(Header)) {
@@ -132,8 +151,10 @@ BasicBlock *LoopNode::getPreHeader() {
     I->replaceSuccessorWith(Header, PreHeader);
     Header->replacePhiUsesWith(Pred, PreHeader);
   }
-  dbgs() << "Made Preheader " << getSimpleNodeLabel(PreHeader) << " for header "
-         << getSimpleNodeLabel(Header) << "\n";
+  UNIT_TRACE(TracePass, dbgs() << "Made Preheader "
+                               << getSimpleNodeLabel(PreHeader)
+                               << " for header " << getSimpleNodeLabel(Header)
+                               << "\n");
   BranchInst *BI = BranchInst::Create(Header, PreHeader);
   LoopInfo->registerPreHeader(this, PreHeader);
 
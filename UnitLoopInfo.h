@@ -96,6 +96,8 @@ public:
 
   void addLoopInfo(BasicBlock *Header, BasicBlocks &BackEdges,
                    DominatorTree &DT);
+  /// Fills the exits and enters of a loop just added by addLoopInfo
+  void computeExits(LoopNode *L);
   void discoverOutmostLoops() {
     for (auto u : AllLoops)
       if (u->Parent == nullptr)
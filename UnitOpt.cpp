@@ -0,0 +1,630 @@
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
+#include "llvm/Passes/StandardInstrumentations.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+
+#include <chrono>
+#include <map>
+#include <memory>
+
+using namespace llvm;
+
+/// unit-opt: opt with the unit passes linked in, for many files at once.
+///
+///   unit-opt -passes=<pipeline> [-S] (-o <file> | -output-dir=<dir>)
+///            [-j=<threads> [-shards=<n>]] <input.ll/.bc>...
+///
+/// The process starts, registers the passes and parses the pipeline once
+/// instead of once per file; the output of each file is what
+/// opt -load-pass-plugin=libUnitProject.so -passes=<pipeline> writes for it.
+/// Every file gets a fresh LLVMContext, so named types keep their names, and
+/// the analysis caches are cleared between files. The time to read,
+/// optimize and write each file is reported on stderr.
+///
+/// With -j the function passes of a large module run in parallel. The
+/// pipeline is cut at its top level into stages: runs of function passes
+/// (function(...), or bare function passes) and everything else. A function
+/// stage splits the module into shards of consecutive functions, loads each
+/// into its own LLVMContext with only its own function bodies, runs the
+/// stage on a thread pool and links the shards back in order, restoring the
+/// linkage and order of every global. Other stages run on the whole module
+/// in between. For function-local passes the result is the serial one.
+
+// Defined in RegisterPasses.cpp, what opt gets from llvmGetPassPluginInfo
+llvm::PassPluginLibraryInfo getUnitProjectPluginInfo();
+
+static cl::list<std::string> InputFiles(cl::Positional, cl::OneOrMore,
+                                        cl::desc("<input .ll/.bc files>"));
+
+static cl::opt<std::string>
+    PassPipeline("passes", cl::Required,
+                 cl::desc("Pipeline to run on every input, as for opt"));
+
+static cl::opt<std::string> OutputFile("o", cl::init("-"),
+                                       cl::value_desc("filename"),
+                                       cl::desc("Output file of one input"));
+
+static cl::opt<std::string>
+    OutputDir("output-dir", cl::value_desc("dir"),
+              cl::desc("Write each input to <dir>/<stem>.bc, or .ll with -S"));
+
+static cl::opt<bool> OutputAssembly("S", cl::desc("Write LLVM assembly"));
+
+static cl::opt<bool> NoOutput("disable-output",
+                              cl::desc("Do not write the optimized modules"));
+
+static cl::opt<unsigned>
+    Threads("j", cl::init(1), cl::value_desc("threads"),
+            cl::desc("Run the function passes on shards of each module on "
+                     "this many threads"));
+
+static cl::opt<unsigned>
+    Shards("shards", cl::init(0),
+           cl::desc("Shards per module with -j (default 4 per thread)"));
+
+using Clock = std::chrono::steady_clock;
+
+static double seconds(Clock::time_point Since) {
+  return std::chrono::duration<double>(Clock::now() - Since).count();
+}
+
+namespace {
+/// What opt builds once per run for a pipeline: target machine, pass builder
+/// with the unit passes registered, analysis managers and the parsed passes
+struct PassSetup {
+  std::unique_ptr<TargetMachine> TM;
+  PassInstrumentationCallbacks PIC;
+  StandardInstrumentations SI{/*DebugLogging=*/false};
+  std::unique_ptr<PassBuilder> PB;
+  LoopAnalysisManager LAM;
+  FunctionAnalysisManager FAM;
+  CGSCCAnalysisManager CGAM;
+  ModuleAnalysisManager MAM;
+  ModulePassManager MPM;
+
+  Error build(const Triple &TT, StringRef Text, bool Verify);
+  void run(Module &M);
+};
+
+/// The pipeline for one target triple. Without -j it is a single stage
+/// with the verifier before and after, as in opt; with it, a list of stages
+/// of which the function ones run sharded
+struct Pipeline {
+  struct Stage {
+    std::string Text;
+    bool Sharded = false;
+    // Runs module stages, and function stages on unshardable modules
+    PassSetup Whole;
+  };
+  Triple TT;
+  std::vector<std::unique_ptr<Stage>> Stages;
+
+  Error build(const Triple &TT);
+  std::unique_ptr<Module> run(std::unique_ptr<Module> M, ThreadPool *Pool);
+};
+} // namespace
+
+Error PassSetup::build(const Triple &TT, StringRef Text, bool Verify) {
+  // As opt: a module without a known target gets no target machine
+  std::string Err;
+  if (TT.getArch())
+    if (const Target *T = TargetRegistry::lookupTarget(TT.str(), Err))
+      TM.reset(T->createTargetMachine(TT.str(), "", "", TargetOptions(),
+                                      None, None, CodeGenOpt::None));
+
+  SI.registerCallbacks(PIC, &FAM);
+  PB = std::make_unique<PassBuilder>(TM.get(), PipelineTuningOptions(), None,
+                                     &PIC);
+  getUnitProjectPluginInfo().RegisterPassBuilderCallbacks(*PB);
+
+  TargetLibraryInfoImpl TLII(TT);
+  FAM.registerPass([TLII] { return TargetLibraryAnalysis(TLII); });
+  PB->registerModuleAnalyses(MAM);
+  PB->registerCGSCCAnalyses(CGAM);
+  PB->registerFunctionAnalyses(FAM);
+  PB->registerLoopAnalyses(LAM);
+  PB->crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+  if (Verify)
+    MPM.addPass(VerifierPass());
+  if (Error E = PB->parsePassPipeline(MPM, Text))
+    return E;
+  if (Verify)
+    MPM.addPass(VerifierPass());
+  return Error::success();
+}
+
+void PassSetup::run(Module &M) {
+  MPM.run(M, MAM);
+  // The cached results point into M, which is about to go
+  LAM.clear();
+  FAM.clear();
+  CGAM.clear();
+  MAM.clear();
+}
+
+/// Elements of a pipeline at parenthesis depth 0
+static SmallVector<StringRef, 8> splitTopLevel(StringRef Text) {
+  SmallVector<StringRef, 8> Elems;
+  int Depth = 0;
+  size_t Begin = 0;
+  for (size_t I = 0; I <= Text.size(); ++I) {
+    if (I == Text.size() || (Text[I] == ',' && !Depth)) {
+      Elems.push_back(Text.slice(Begin, I));
+      Begin = I + 1;
+    } else if (Text[I] == '(') {
+      ++Depth;
+    } else if (Text[I] == ')') {
+      --Depth;
+    }
+  }
+  return Elems;
+}
+
+Error Pipeline::build(const Triple &T) {
+  TT = T;
+  auto Whole = std::make_unique<Stage>();
+  Whole->Text = PassPipeline;
+  // Rejects what opt rejects, with its message
+  if (Error E = Whole->Whole.build(TT, PassPipeline, /*Verify=*/true))
+    return E;
+  if (Threads <= 1) {
+    Stages.push_back(std::move(Whole));
+    return Error::success();
+  }
+  SmallVector<StringRef, 8> Elems = splitTopLevel(PassPipeline);
+  SmallVector<bool, 8> IsFunction;
+  for (StringRef Elem : Elems) {
+    FunctionPassManager FPM;
+    IsFunction.push_back(
+        !errorToBool(Whole->Whole.PB->parsePassPipeline(FPM, Elem)));
+  }
+  // A pipeline of function passes only is one function pipeline
+  if (all_of(IsFunction, [](bool F) { return F; })) {
+    Whole->Sharded = true;
+    Stages.push_back(std::move(Whole));
+    return Error::success();
+  }
+  // Otherwise it is a module pipeline, where opt runs each bare function
+  // pass in a function(...) of its own
+  for (size_t I = 0; I < Elems.size(); ++I) {
+    if (Stages.empty() || Stages.back()->Sharded != IsFunction[I]) {
+      Stages.push_back(std::make_unique<Stage>());
+      Stages.back()->Sharded = IsFunction[I];
+    }
+    std::string &Text = Stages.back()->Text;
+    if (!Text.empty())
+      Text += ",";
+    if (IsFunction[I] && !Elems[I].startswith("function("))
+      Text += ("function(" + Elems[I] + ")").str();
+    else
+      Text += Elems[I].str();
+  }
+  for (auto &S : Stages) {
+    // Parsed as a module pipeline whatever the first pass is
+    if (!S->Sharded)
+      S->Text = "module(" + S->Text + ")";
+    if (Error E = S->Whole.build(TT, S->Text, /*Verify=*/false))
+      return E;
+  }
+  return Error::success();
+}
+
+/// The setup a pool thread runs a function stage with, built on first use
+static PassSetup &threadSetup(const Triple &TT, const std::string &Text) {
+  thread_local std::map<std::pair<std::string, std::string>,
+                        std::unique_ptr<PassSetup>>
+      Setups;
+  auto &S = Setups[{TT.str(), Text}];
+  if (!S) {
+    S = std::make_unique<PassSetup>();
+    // Parsed once already by Pipeline::build
+    cantFail(S->build(TT, Text, /*Verify=*/false));
+  }
+  return *S;
+}
+
+/// Whether linking the shards back gives the module they came from. Comdat
+/// members, aliases and debug info would need to move between shards
+/// together; such modules run function stages whole.
+static bool canShard(const Module &M) {
+  unsigned Defined = 0;
+  for (const Function &F : M)
+    Defined += !F.isDeclaration();
+  return Defined > 1 && M.getComdatSymbolTable().empty() && M.alias_empty() &&
+         M.ifunc_empty() && !M.getNamedMetadata("llvm.dbg.cu");
+}
+
+namespace {
+/// A local global the passes created in a shard, linked under a temporary
+/// name as an external one
+struct Created {
+  std::string TempName, Name;
+  GlobalValue::LinkageTypes Linkage;
+};
+
+struct ShardResult {
+  SmallVector<char, 0> Bitcode;
+  std::vector<Created> New;
+};
+} // namespace
+
+// Prefixes of the names shards link under
+static const char RefPrefix[] = "__unit_opt.ref.";
+static const char NewPrefix[] = "__unit_opt.new.";
+
+/// The name a pass asked for when the symbol table gave a global Name
+static std::string requestedName(const Module &M, StringRef Name) {
+  StringRef Base, Suffix;
+  std::tie(Base, Suffix) = Name.rsplit('.');
+  if (!Base.empty() && !Suffix.empty() &&
+      all_of(Suffix, [](char C) { return isDigit(C); }) &&
+      M.getNamedValue(Base))
+    return Base.str();
+  return Name.str();
+}
+
+/// How many times the symbol table of M has numbered a name to make it
+/// unique. Leaves two probe globals' worth of numbering behind.
+static unsigned uniqueCounter(Module &M) {
+  Type *Ty = Type::getInt8Ty(M.getContext());
+  GlobalVariable *Probe[2];
+  for (auto *&P : Probe)
+    P = new GlobalVariable(M, Ty, false, GlobalValue::ExternalLinkage,
+                           nullptr, "__unit_opt.probe");
+  unsigned N = 0;
+  Probe[1]->getName().rsplit('.').second.getAsInteger(10, N);
+  for (auto *P : Probe)
+    P->eraseFromParent();
+  return N - 1;
+}
+
+/// Numbers names until the symbol table of M has done so N times
+static void setUniqueCounter(Module &M, unsigned N) {
+  Type *Ty = Type::getInt8Ty(M.getContext());
+  std::vector<GlobalVariable *> Dummies;
+  for (unsigned I = 0; I <= N; ++I)
+    Dummies.push_back(new GlobalVariable(M, Ty, false,
+                                         GlobalValue::ExternalLinkage,
+                                         nullptr, "__unit_opt.count"));
+  for (auto *D : Dummies)
+    D->eraseFromParent();
+}
+
+/// Runs Text on shard K of the module in Bitcode, in a context of its own:
+/// the bodies of the functions Owner gives to other shards are dropped.
+/// Afterwards the shard is made to link without a name clash: global
+/// variables are left to shard 0, every original definition is made
+/// external, declarations of what other shards define are renamed with
+/// RefPrefix and the local globals the passes created with NewPrefix.
+static ShardResult runShard(MemoryBufferRef Bitcode, ArrayRef<int> Owner,
+                            int K, const Triple &TT,
+                            const std::string &Text) {
+  LLVMContext Context;
+  std::unique_ptr<Module> M = cantFail(getLazyBitcodeModule(Bitcode, Context));
+  std::vector<GlobalObject *> Foreign;
+  unsigned I = 0;
+  for (Function &F : *M)
+    if (Owner[I++] != K && !F.isDeclaration()) {
+      F.deleteBody();
+      Foreign.push_back(&F);
+    }
+  cantFail(M->materializeAll());
+
+  SmallPtrSet<GlobalValue *, 32> Original;
+  for (GlobalValue &GV : M->global_values())
+    Original.insert(&GV);
+  threadSetup(TT, Text).run(*M);
+
+  ShardResult R;
+  std::vector<GlobalValue *> New;
+  for (GlobalValue &GV : M->global_values())
+    if (!Original.count(&GV) && GV.hasLocalLinkage()) {
+      New.push_back(&GV);
+      R.New.push_back({"", requestedName(*M, GV.getName()), GV.getLinkage()});
+    }
+  for (size_t I = 0; I < New.size(); ++I) {
+    New[I]->setName(NewPrefix + Twine(K) + "." + Twine(I));
+    New[I]->setLinkage(GlobalValue::ExternalLinkage);
+    R.New[I].TempName = New[I]->getName().str();
+  }
+
+  for (GlobalObject &GO : M->global_objects()) {
+    if (!Original.count(&GO) || GO.isDeclaration())
+      continue;
+    if (K && isa<GlobalVariable>(GO)) {
+      cast<GlobalVariable>(GO).setInitializer(nullptr);
+      Foreign.push_back(&GO);
+    }
+    GO.setLinkage(GlobalValue::ExternalLinkage);
+  }
+  for (GlobalObject *GO : Foreign)
+    GO->setName(RefPrefix + GO->getName());
+  // Module flags and named metadata come from shard 0
+  if (K)
+    for (NamedMDNode &NMD : make_early_inc_range(M->named_metadata()))
+      M->eraseNamedMetadata(&NMD);
+
+  // Use-list order shows in the predecessor comments of the output
+  raw_svector_ostream OS(R.Bitcode);
+  WriteBitcodeToFile(*M, OS, /*ShouldPreserveUseListOrder=*/true);
+  return R;
+}
+
+/// Moves the globals of List named in Order to the front, in that order;
+/// globals the passes created follow in the order linking left them
+template <typename ListT, typename LookupT>
+static void restoreOrder(ListT &List, ArrayRef<std::string> Order,
+                         LookupT Lookup) {
+  auto Created = List.begin();
+  for (const std::string &Name : Order) {
+    auto *GV = Lookup(Name);
+    if (Created != GV->getIterator())
+      List.splice(Created, List, GV->getIterator());
+    else
+      ++Created;
+  }
+}
+
+static std::unique_ptr<Module> runSharded(std::unique_ptr<Module> M,
+                                          const Pipeline::Stage &S,
+                                          const Triple &TT,
+                                          ThreadPool &Pool) {
+  // Where the serial run would number the next clashing name from
+  unsigned Counter = uniqueCounter(*M);
+
+  // Linking goes by name: name the unnamed globals for the trip, and take
+  // down how each global looked and where it was
+  struct Original {
+    GlobalValue::LinkageTypes Linkage;
+    GlobalValue::VisibilityTypes Visibility;
+    bool DSOLocal, Unnamed;
+  };
+  StringMap<Original> Originals;
+  std::vector<std::string> VarOrder, FuncOrder;
+  for (GlobalValue &GV : M->global_values()) {
+    bool Unnamed = !GV.hasName();
+    if (Unnamed)
+      GV.setName("__unit_opt.unnamed");
+    Originals[GV.getName()] = {GV.getLinkage(), GV.getVisibility(),
+                               GV.isDSOLocal(), Unnamed};
+  }
+  for (GlobalVariable &GV : M->globals())
+    VarOrder.push_back(GV.getName().str());
+  for (Function &F : *M)
+    FuncOrder.push_back(F.getName().str());
+
+  // Consecutive functions of about the same number of instructions per shard
+  unsigned NumFuncs = 0;
+  uint64_t Size = 0;
+  for (Function &F : *M)
+    if (!F.isDeclaration()) {
+      ++NumFuncs;
+      Size += F.getInstructionCount();
+    }
+  unsigned N = std::min(Shards ? Shards : 4 * Threads, NumFuncs);
+  std::vector<int> Owner;
+  int K = 0;
+  uint64_t Done = 0;
+  for (Function &F : *M) {
+    if (F.isDeclaration()) {
+      Owner.push_back(-1);
+      continue;
+    }
+    Owner.push_back(K);
+    Done += F.getInstructionCount();
+    if (K + 1u < N && Done * N >= Size * (K + 1))
+      ++K;
+  }
+
+  SmallVector<char, 0> Bitcode;
+  raw_svector_ostream OS(Bitcode);
+  WriteBitcodeToFile(*M, OS, /*ShouldPreserveUseListOrder=*/true);
+  MemoryBufferRef Buffer(StringRef(Bitcode.data(), Bitcode.size()),
+                         "unit-opt");
+  std::vector<std::shared_future<ShardResult>> Results;
+  for (int I = 0; I <= K; ++I)
+    Results.push_back(Pool.async(
+        [&, I] { return runShard(Buffer, Owner, I, TT, S.Text); }));
+
+  // The shards bring their own copies of the named types; the originals
+  // give up their names, or the copies would read back as %T.1
+  LLVMContext &Context = M->getContext();
+  std::string ModuleID = M->getModuleIdentifier();
+  std::vector<StructType *> Types = M->getIdentifiedStructTypes();
+  M.reset();
+  for (StructType *ST : Types)
+    ST->setName("");
+
+  // In shard order, whichever thread finished first
+  std::unique_ptr<Module> Linked;
+  for (auto &Result : Results) {
+    const SmallVector<char, 0> &Shard = Result.get().Bitcode;
+    MemoryBufferRef Ref(StringRef(Shard.data(), Shard.size()), "shard");
+    std::unique_ptr<Module> SM = cantFail(parseBitcodeFile(Ref, Context));
+    if (!Linked)
+      Linked = std::move(SM);
+    else if (Linker::linkModules(*Linked, std::move(SM)))
+      report_fatal_error("unit-opt: linking the shards failed");
+  }
+
+  for (GlobalValue &GV : make_early_inc_range(Linked->global_values()))
+    if (GV.getName().startswith(RefPrefix)) {
+      GlobalValue *Def =
+          Linked->getNamedValue(GV.getName().drop_front(strlen(RefPrefix)));
+      GV.replaceAllUsesWith(
+          ConstantExpr::getPointerBitCastOrAddrSpaceCast(Def, GV.getType()));
+      GV.eraseFromParent();
+    }
+  restoreOrder(Linked->getGlobalList(), VarOrder, [&](StringRef Name) {
+    return Linked->getGlobalVariable(Name, /*AllowLocal=*/true);
+  });
+  restoreOrder(Linked->getFunctionList(), FuncOrder,
+               [&](StringRef Name) { return Linked->getFunction(Name); });
+  for (auto &O : Originals) {
+    GlobalValue *GV = Linked->getNamedValue(O.getKey());
+    GV->setLinkage(O.getValue().Linkage);
+    GV->setVisibility(O.getValue().Visibility);
+    GV->setDSOLocal(O.getValue().DSOLocal);
+    if (O.getValue().Unnamed)
+      GV->setName("");
+  }
+  // Created globals take their names in the order the serial run creates
+  // them, with the same numbering where the names clash
+  setUniqueCounter(*Linked, Counter);
+  for (auto &Result : Results)
+    for (const Created &C : Result.get().New) {
+      GlobalValue *GV = Linked->getNamedValue(C.TempName);
+      GV->setName(C.Name);
+      GV->setLinkage(C.Linkage);
+    }
+  Linked->setModuleIdentifier(ModuleID);
+  return Linked;
+}
+
+std::unique_ptr<Module> Pipeline::run(std::unique_ptr<Module> M,
+                                      ThreadPool *Pool) {
+  for (auto &S : Stages) {
+    if (S->Sharded && canShard(*M))
+      M = runSharded(std::move(M), *S, TT, *Pool);
+    else
+      S->Whole.run(*M);
+  }
+  // What the verifier passes of the single stage do otherwise
+  if (Pool && verifyModule(*M, &errs()))
+    report_fatal_error("Broken module found, compilation aborted!");
+  return M;
+}
+
+static std::string outputFor(StringRef Input) {
+  if (OutputDir.empty())
+    return OutputFile;
+  SmallString<128> Path(OutputDir);
+  sys::path::append(Path, sys::path::stem(Input));
+  Path += OutputAssembly ? ".ll" : ".bc";
+  return std::string(Path);
+}
+
+static bool writeModule(Module &M, StringRef Path) {
+  std::error_code EC;
+  ToolOutputFile Out(Path, EC,
+                     OutputAssembly ? sys::fs::OF_TextWithCRLF
+                                    : sys::fs::OF_None);
+  if (EC) {
+    errs() << "unit-opt: " << Path << ": " << EC.message() << "\n";
+    return false;
+  }
+  if (OutputAssembly)
+    M.print(Out.os(), nullptr);
+  else
+    WriteBitcodeToFile(M, Out.os(), /*ShouldPreserveUseListOrder=*/true);
+  Out.keep();
+  return true;
+}
+
+int main(int argc, char **argv) {
+  InitLLVM X(argc, argv);
+  InitializeAllTargetInfos();
+  InitializeAllTargets();
+  InitializeAllTargetMCs();
+  cl::ParseCommandLineOptions(argc, argv, "unit-opt: batch optimizer\n");
+
+  if (OutputDir.empty() && !NoOutput && InputFiles.size() > 1) {
+    errs() << "unit-opt: -output-dir is needed with more than one input\n";
+    return 1;
+  }
+  StringSet<> Outputs;
+  if (!OutputDir.empty() && !NoOutput) {
+    if (std::error_code EC = sys::fs::create_directories(OutputDir)) {
+      errs() << "unit-opt: " << OutputDir << ": " << EC.message() << "\n";
+      return 1;
+    }
+    for (auto &Input : InputFiles)
+      if (!Outputs.insert(outputFor(Input)).second) {
+        errs() << "unit-opt: two inputs would write " << outputFor(Input)
+               << "\n";
+        return 1;
+      }
+  }
+  if (!NoOutput && !OutputAssembly && OutputDir.empty() &&
+      OutputFile == "-" && outs().is_displayed()) {
+    errs() << "unit-opt: not writing bitcode to a terminal, use -S\n";
+    return 1;
+  }
+
+  // Shared by all inputs, so each thread sets up its passes once
+  std::unique_ptr<ThreadPool> Pool;
+  if (Threads > 1)
+    Pool = std::make_unique<ThreadPool>(hardware_concurrency(Threads));
+  std::map<std::string, std::unique_ptr<Pipeline>> Pipelines;
+  int Status = 0;
+  double Total[3] = {0, 0, 0};
+  errs() << "     read  optimize     write  file\n";
+  for (auto &Input : InputFiles) {
+    auto Start = Clock::now();
+    LLVMContext Context;
+    SMDiagnostic Diag;
+    std::unique_ptr<Module> M = parseIRFile(Input, Diag, Context);
+    if (!M) {
+      Diag.print("unit-opt", errs());
+      Status = 1;
+      continue;
+    }
+    if (verifyModule(*M, &errs())) {
+      errs() << "unit-opt: " << Input << ": input is not valid IR\n";
+      Status = 1;
+      continue;
+    }
+    double Read = seconds(Start);
+
+    auto &P = Pipelines[M->getTargetTriple()];
+    if (!P) {
+      auto SetupStart = Clock::now();
+      P = std::make_unique<Pipeline>();
+      if (Error E = P->build(Triple(M->getTargetTriple()))) {
+        errs() << "unit-opt: " << toString(std::move(E)) << "\n";
+        return 1;
+      }
+      errs() << format("%9.4f                      (setup for '%s')\n",
+                       seconds(SetupStart), M->getTargetTriple().c_str());
+    }
+    Start = Clock::now();
+    M = P->run(std::move(M), Pool.get());
+    double Optimize = seconds(Start);
+
+    Start = Clock::now();
+    if (!NoOutput && !writeModule(*M, outputFor(Input)))
+      Status = 1;
+    double Write = seconds(Start);
+
+    errs() << format("%9.4f %9.4f %9.4f  %s\n", Read, Optimize, Write,
+                     Input.c_str());
+    Total[0] += Read;
+    Total[1] += Optimize;
+    Total[2] += Write;
+  }
+  errs() << format("%9.4f %9.4f %9.4f  total\n", Total[0], Total[1],
+                   Total[2]);
+  return Status;
+}
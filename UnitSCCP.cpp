@@ -1,28 +1,77 @@
 // Usage: opt -load-pass-plugin=libUnitProject.so -passes="unit-sccp"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/ConstantFolding.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/PatternMatch.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Local.h"
 
 #include "UnitSCCP.h"
+#include "UnitStats.h"
+#include "UnitTrace.h"
 
 #define DEBUG_TYPE "UnitSCCP"
+// Remarks go under the pipeline name, as LLVM's own passes' do, so that
+// -pass-remarks=unit-sccp selects them
+#define REMARK_PASS "unit-sccp"
 // Define any statistics here
 
 using namespace llvm;
 using namespace cs426;
+using namespace llvm::PatternMatch;
 
 STATISTIC(IRemove, "Number of instructions removed");
 STATISTIC(Beach, "Number of basic blocks unreachable");
 STATISTIC(ISimp, "Number of instructions simplified");
+STATISTIC(IBits, "Number of instructions folded by known bits");
+STATISTIC(IPred, "Number of uses replaced from branch predicates");
+STATISTIC(ILoad, "Number of loads folded");
+STATISTIC(ICall, "Number of calls folded");
+STATISTIC(INull, "Number of pointer comparisons folded by nullness");
+STATISTIC(IOvf, "Number of overflow bits decided by predicate ranges");
+
+static cl::opt<bool>
+    KnownBitsMode("unit-sccp-known-bits", cl::init(true), cl::Hidden,
+                  cl::desc("Track known-zero/known-one bits of integers"));
+static cl::opt<bool>
+    NullnessMode("unit-sccp-nullness", cl::init(true), cl::Hidden,
+                 cl::desc("Track null/non-null pointers to fold null checks"));
 
 /// Main function for running the SCCP optimization
 PreservedAnalyses UnitSCCP::run(Function &F, FunctionAnalysisManager &FAM) {
-  dbgs() << "UnitSCCP running on " << F.getName() << "\n";
+  UNIT_TRACE(TracePass,
+             dbgs() << "UnitSCCP running on " << F.getName() << "\n");
 
+  StatsRecord Stats("UnitSCCP", F);
+  auto &DT = FAM.getResult<DominatorTreeAnalysis>(F);
+  auto &TLI = FAM.getResult<TargetLibraryAnalysis>(F);
   // Perform the optimization
+  {
+    StatsRecord::Phase P(Stats, "solve");
+    Solver.solve(F, DT, TLI);
+  }
+  auto &ORE = FAM.getResult<OptimizationRemarkEmitterAnalysis>(F);
+  if (ORE.allowExtraAnalysis(REMARK_PASS))
+    Solver.emitRemarks(F, ORE);
+  {
+    StatsRecord::Phase P(Stats, "rewrite");
+    Solver.rewrite(F);
+  }
+  Stats.count("block_visits", Solver.Counts.BlockVisits);
+  Stats.count("block_revisits", Solver.Counts.BlockRevisits);
+  Stats.count("flow_pushes", Solver.Counts.FlowPushes);
+  Stats.count("ssa_pushes", Solver.Counts.SSAPushes);
+  Stats.count("ssa_visits", Solver.Counts.SSAVisits);
 
+  // Set proper preserved analyses
+  return PreservedAnalyses();
+}
+void SCCPSolver::solve(Function &F, DominatorTree &DT,
+                       TargetLibraryInfo &TLI) {
   // ? Don’t propagate into operation until its block is executable.
   // ? Ignore phi argument if incoming CFG edge not executable
   // ? If variable changes value, add SSA out-edges to SSAQ
@@ -32,112 +81,349 @@ PreservedAnalyses UnitSCCP::run(Function &F, FunctionAnalysisManager &FAM) {
   // ? By edge: revisit block if new executable edge
   // ! By block: only revisit instruction on need; may mark constant as bottom?
 
-  init(F);
-  while (!FlowQ.empty() || !SSAQ.empty()) {
-    while (!FlowQ.empty()) { // Executable
-      auto BB = FlowQ.front();
-      FlowQ.pop();
-      dbgs() << "\nFlowQ: Take Block from Flow queue:" << getSimpleNodeLabel(BB)
-             << "\n";
-      visitBlock(BB);
-      FlowMark[BB] = true;
-    }
-    while (!SSAQ.empty()) { // Variable Changes
-                            // TODO:inq
-      Value *V = SSAQ.front();
-      SSAQ.pop();
-      InSSAQ[V] = false;
-      if (auto I = dyn_cast<Instruction>(V)) {
-        dbgs() << "\nSSAQ: Take Instruction from SSA queue:" << *I << "\n";
-        visitInstruction(I);
-      } else {
-        assert(false);
-      }
-    }
-  }
-  // Set proper preserved analyses
-  for (auto v : LatCell) {
-    if (auto I = dyn_cast<Instruction>(v.first)) {
-      if (v.second.isConstant()) {
-        dbgs() << "Found Const: " << *I << " of value " << v.second.info()
-               << "\n";
+  this->DT = &DT;
+  DL = &F.getParent()->getDataLayout();
+  this->TLI = &TLI;
+  run(F);
+}
+bool SCCPSolver::rewrite(Function &F) {
+  bool Changed = replacePredicatedUses();
+  for (auto V : LatCell.keys()) {
+    if (auto I = dyn_cast<Instruction>(V)) {
+      auto LV = LatCell[I];
+      if (LV.isConstant() || LV.isUndef()) {
+        UNIT_TRACE(TracePass, dbgs() << "Found Const: " << *I << " of value "
+                                     << LV.info() << "\n");
         BasicBlock::iterator ii(I);
-        dbgs() << I << v.second.Val << "\n";
+        // Only values written back become Constants in the context
+        auto C = LV.get(I->getType());
         for (auto _ : I->users())
           ISimp++;
+        Changed = true;
+        // Folded library calls may still have side effects to keep
+        if (!wouldInstructionBeTriviallyDead(I, TLI)) {
+          I->replaceAllUsesWith(C);
+          continue;
+        }
         IRemove++;
-        ReplaceInstWithValue(I->getParent()->getInstList(), ii, v.second.Val);
+        ReplaceInstWithValue(I->getParent()->getInstList(), ii, C);
       }
     }
   }
+  // Count the blocks the solver never reached, each one once
   DenseSet<BasicBlock *> V;
+  V.insert(&F.getEntryBlock());
   FlowQ.push(&F.getEntryBlock());
   while (!FlowQ.empty()) { // Executable
-    auto BB = FlowQ.front();
-    FlowQ.pop();
-    V.insert(BB);
+    auto BB = FlowQ.pop();
     if (FlowMark[BB] == false)
       Beach++;
     for (auto SBB : successors(BB)) {
-      if (!V.contains(SBB))
+      if (V.insert(SBB).second)
         FlowQ.push(SBB);
     }
   }
-
-  dbgs() << "\n\n";
-  return PreservedAnalyses();
+  return Changed;
 }
-void UnitSCCP::init(Function &F) {
-  LatCell.clear();
-  ExecFlag.clear();
-  FlowMark.clear();
-  FlowQ.push(&F.getEntryBlock());
-  for (auto &V : F.args()) {
-    LatCell[&V] = bottom;
+void SCCPSolver::emitRemarks(Function &F, OptimizationRemarkEmitter &ORE) {
+  for (auto &BB : F) {
+    if (!FlowMark[&BB])
+      continue;
+    for (auto &I : BB) {
+      if (I.getType()->isVoidTy() || !LatCell.count(&I))
+        continue;
+      auto LV = LatCell[&I];
+      if (LV.isConstant() || LV.isUndef()) {
+        ORE.emit([&] {
+          return OptimizationRemark(REMARK_PASS, "Folded", &I)
+                 << "folded " << ore::NV("Inst", &I) << " to "
+                 << ore::NV("Constant", LV.get(I.getType()));
+        });
+        continue;
+      }
+      // An alloca is an address, never a constant to miss
+      if (!LV.isBottom() || isa<AllocaInst>(I))
+        continue;
+      // The first operand already bottom on an executable path is the
+      // cause; otherwise the instruction itself lost the value
+      auto IsBottom = [&](Value *V) {
+        return LatCell.count(V) && LatCell[V].isBottom();
+      };
+      Value *Cause = nullptr;
+      if (auto PN = dyn_cast<PHINode>(&I)) {
+        for (unsigned i = 0; i < PN->getNumIncomingValues() && !Cause; i++)
+          if (ExecFlag[Edge(PN->getIncomingBlock(i), &BB)] &&
+              IsBottom(PN->getIncomingValue(i)))
+            Cause = PN->getIncomingValue(i);
+      } else {
+        for (auto &Op : I.operands())
+          if (IsBottom(Op)) {
+            Cause = Op;
+            break;
+          }
+      }
+      ORE.emit([&] {
+        if (Cause)
+          return OptimizationRemarkMissed(REMARK_PASS, "OverdefinedOperand", &I)
+                 << "not constant: operand " << ore::NV("Operand", Cause)
+                 << " is not constant";
+        if (isa<PHINode>(I))
+          return OptimizationRemarkMissed(REMARK_PASS, "PhiConflict", &I)
+                 << "not constant: incoming values differ";
+        if (isa<LoadInst>(I))
+          return OptimizationRemarkMissed(REMARK_PASS, "UnknownMemory", &I)
+                 << "not constant: loads memory the solver does not track";
+        if (auto CB = dyn_cast<CallBase>(&I))
+          return OptimizationRemarkMissed(REMARK_PASS, "OpaqueCall", &I)
+                 << "not constant: result of call to "
+                 << ore::NV("Callee", CB->getCalledOperand());
+        return OptimizationRemarkMissed(REMARK_PASS, "NotFoldable", &I)
+               << "not constant: " << ore::NV("Opcode", I.getOpcodeName())
+               << " does not fold on these operands";
+      });
+    }
+  }
+}
+void SCCPSolver::reset() {
+  SparseSolver::reset();
+  BitCell.reset();
+  NullCell.reset();
+  Derefs.reset();
+  EdgeFacts.reset();
+  ValueFacts.reset();
+  SlotOf.reset();
+  MemCell.reset();
+  SlotLoads.reset();
+  SlotTypes.reset();
+}
+/// Narrow \p CR by \p Fact; contradicting facts only guard dead code
+static void narrowRange(const ConstantRange &Fact, ConstantRange &CR) {
+  auto N = CR.intersectWith(Fact);
+  if (!N.isEmptySet())
+    CR = N;
+}
+void SCCPSolver::initialize(Function &F) {
+  SparseSolver::initialize(F);
+  DT->updateDFSNumbers();
+  for (auto &I : F.getEntryBlock())
+    if (auto AI = dyn_cast<AllocaInst>(&I))
+      initSlots(AI);
+  if (NullnessMode)
+    collectDerefs(F);
+  for (auto &BB : F) {
+    auto Br = dyn_cast<BranchInst>(BB.getTerminator());
+    if (!Br || Br->isUnconditional() ||
+        Br->getSuccessor(0) == Br->getSuccessor(1))
+      continue;
+    for (uint i = 0; i < 2; i++) {
+      vector<PredicateFact> Facts;
+      collectFacts(Br->getCondition(), i == 0, Facts);
+      if (Facts.empty())
+        continue;
+      auto SuccBB = Br->getSuccessor(i);
+      auto N = DT->getNode(SuccBB);
+      if (N && DT->dominates(BasicBlockEdge(&BB, SuccBB), SuccBB))
+        for (auto &PF : Facts)
+          ValueFacts[PF.V].add(N, PF.Range);
+      EdgeFacts[Edge(&BB, SuccBB)] = std::move(Facts);
+    }
+  }
+  for (auto V : ValueFacts.keys())
+    ValueFacts[V].link(narrowRange);
+}
+/// Record what taking the true (or false) edge of a branch on \p Cond tells
+/// about the operands of the integer comparisons it is made of
+void SCCPSolver::collectFacts(Value *Cond, bool OnTrue,
+                              vector<PredicateFact> &Facts) {
+  if (isa<Constant>(Cond))
+    return;
+  Facts.push_back({Cond, ConstantRange(APInt(1, OnTrue))});
+  Value *L, *R;
+  if ((OnTrue && match(Cond, m_LogicalAnd(m_Value(L), m_Value(R)))) ||
+      (!OnTrue && match(Cond, m_LogicalOr(m_Value(L), m_Value(R))))) {
+    collectFacts(L, OnTrue, Facts);
+    collectFacts(R, OnTrue, Facts);
+    return;
   }
+  auto Cmp = dyn_cast<ICmpInst>(Cond);
+  if (!Cmp)
+    return;
+  auto Pred = OnTrue ? Cmp->getPredicate() : Cmp->getInversePredicate();
+  Value *V = Cmp->getOperand(0);
+  // Null checks become a range of the pointer's address
+  if (V->getType()->isPointerTy()) {
+    if (isa<ConstantPointerNull>(V)) {
+      V = Cmp->getOperand(1);
+      Pred = CmpInst::getSwappedPredicate(Pred);
+    } else if (!isa<ConstantPointerNull>(Cmp->getOperand(1))) {
+      return;
+    }
+    if (isa<Constant>(V))
+      return;
+    APInt Null(DL->getPointerTypeSizeInBits(V->getType()), 0);
+    Facts.push_back({V, ConstantRange::makeExactICmpRegion(Pred, Null)});
+    return;
+  }
+  auto C = dyn_cast<ConstantInt>(Cmp->getOperand(1));
+  if (!C) {
+    C = dyn_cast<ConstantInt>(V);
+    V = Cmp->getOperand(1);
+    Pred = CmpInst::getSwappedPredicate(Pred);
+  }
+  if (!C || isa<Constant>(V))
+    return;
+  Facts.push_back({V, ConstantRange::makeExactICmpRegion(Pred, C->getValue())});
+}
+/// Range of \p V at the start of \p BB, or on the edge \p From -> \p BB,
+/// as far as the lattice and the dominating branch conditions know it.
+/// Pointers get the range of their address, which only null checks narrow.
+ConstantRange SCCPSolver::getRangeAt(Value *V, BasicBlock *BB,
+                                     BasicBlock *From) {
+  unsigned BW = V->getType()->isPointerTy()
+                    ? DL->getPointerTypeSizeInBits(V->getType())
+                    : V->getType()->getIntegerBitWidth();
+  auto LV = getLattice(V);
+  if (LV.isInt())
+    return ConstantRange(LV.Int);
+  auto CR = ConstantRange::getFull(BW);
+  if (!LV.isBottom())
+    return CR;
+  if (From) {
+    if (auto Facts = EdgeFacts.find(Edge(From, BB)))
+      for (auto &PF : *Facts)
+        if (PF.V == V)
+          narrowRange(PF.Range, CR);
+    BB = From;
+  }
+  auto Facts = ValueFacts.find(V);
+  auto N = Facts ? DT->getNode(BB) : nullptr;
+  int i = N ? Facts->find(N) : -1;
+  if (i >= 0)
+    narrowRange((*Facts)[i], CR);
+  return CR;
+}
+LatticeElem SCCPSolver::getLatticeAt(Value *V, BasicBlock *BB,
+                                     BasicBlock *From) {
+  auto LV = getLattice(V);
+  if (!LV.isBottom() || !V->getType()->isIntegerTy())
+    return LV;
+  if (auto C = getRangeAt(V, BB, From).getSingleElement())
+    return *C;
+  return LV;
 }
-void UnitSCCP::visitBlock(BasicBlock *BB) {
-  for (auto &I : *BB)
-    visitInstruction(&I);
+/// Rewrite uses of non-constant values inside blocks guarded by an equality
+bool SCCPSolver::replacePredicatedUses() {
+  bool Changed = false;
+  for (auto V : ValueFacts.keys()) {
+    auto &Facts = ValueFacts[V];
+    for (int i = 0, n = Facts.size(); i < n; i++) {
+      auto FactBB = Facts.block(i);
+      auto C = Facts[i].getSingleElement();
+      if (!FlowMark[FactBB] || !C || !getLattice(V).isBottom())
+        continue;
+      auto Const = V->getType()->isPointerTy()
+                       ? Constant::getNullValue(V->getType())
+                       : ConstantInt::get(V->getType(), *C);
+      V->replaceUsesWithIf(Const, [&](Use &U) {
+        auto UI = dyn_cast<Instruction>(U.getUser());
+        if (!UI)
+          return false;
+        auto UseBB = UI->getParent();
+        if (auto Phi = dyn_cast<PHINode>(UI))
+          UseBB = Phi->getIncomingBlock(U);
+        if (!DT->dominates(FactBB, UseBB))
+          return false;
+        IPred++;
+        Changed = true;
+        return true;
+      });
+    }
+  }
+  return Changed;
 }
-void UnitSCCP::visitBranch(BranchInst *I) {
+void SCCPSolver::visitBranch(BranchInst *I) {
   vector<int> choice;
   if (I->isUnconditional())
     choice = {0};
   else {
-    auto LV = getLattice(I->getCondition());
+    auto LV = getLatticeAt(I->getCondition(), I->getParent());
     if (LV.Status == bottom)
       choice = {0, 1};
+    else if (LV.isUndef())
+      choice = {0}; // branching on undef is undefined, any successor will do
     else {
-      if (LV.Val->isNullValue())
+      if (LV.isNullValue())
         choice = {1};
       else
         choice = {0};
     }
   }
 
-  for (auto i : choice) {
-    auto SuccBB = I->getSuccessor(i);
-    Edge E(I->getParent(), SuccBB);
-    if (!FlowMark[SuccBB] || !ExecFlag[E]) {
-      dbgs() << "visitBr: Mark edge " << edgeInfo(E) << " executable\n";
-      // TODO: inq check?
-      FlowQ.push(SuccBB);
-    }
-    ExecFlag[E] = true;
+  for (auto i : choice)
+    markEdgeExecutable(I->getParent(), I->getSuccessor(i));
+}
+void SCCPSolver::visitSwitch(SwitchInst *I) {
+  auto LV = getLatticeAt(I->getCondition(), I->getParent());
+  if (LV.isBottom()) {
+    SparseSolver::visitTerminator(I);
+    return;
   }
+  // Switching on undef is undefined as well
+  BasicBlock *Succ = I->getDefaultDest();
+  if (LV.isConstant()) {
+    auto C = cast<ConstantInt>(LV.get(I->getCondition()->getType()));
+    Succ = I->findCaseValue(C)->getCaseSuccessor();
+  }
+  markEdgeExecutable(I->getParent(), Succ);
 }
-void UnitSCCP::visitInstruction(Instruction *I) {
-  if (auto Br = dyn_cast<BranchInst>(I)) {
+void SCCPSolver::visitIndirectBr(IndirectBrInst *I) {
+  auto LV = getLatticeAt(I->getAddress(), I->getParent());
+  auto BA = LV.isConstant() ? dyn_cast<BlockAddress>(LV.Val) : nullptr;
+  if (!BA || BA->getFunction() != I->getFunction()) {
+    SparseSolver::visitTerminator(I);
+    return;
+  }
+  markEdgeExecutable(I->getParent(), BA->getBasicBlock());
+}
+void SCCPSolver::visitTerminator(Instruction *I) {
+  if (auto Br = dyn_cast<BranchInst>(I))
     visitBranch(Br);
+  else if (auto SI = dyn_cast<SwitchInst>(I))
+    visitSwitch(SI);
+  else if (auto IBr = dyn_cast<IndirectBrInst>(I))
+    visitIndirectBr(IBr);
+  else {
+    // invoke, callbr and the exception handling terminators
+    SparseSolver::visitTerminator(I);
+    if (tracksNull(I) && updateNull(I, MaybeNull))
+      addSSAOutEdges(I);
+  }
+}
+void SCCPSolver::visitInstruction(Instruction *I) {
+  if (I->isTerminator()) {
+    SparseSolver::visitInstruction(I);
+    return;
+  }
+  if (auto St = dyn_cast<StoreInst>(I)) {
+    visitStore(St);
+    return;
+  }
+  if (auto MI = dyn_cast<MemIntrinsic>(I)) {
+    visitMemIntrinsic(MI);
     return;
   }
 
-  auto &LV = LatCell[I];
-  if (LV.isBottom())
+  // Cells live in DenseMaps: no reference into them across evaluation
+  bool Bottom = LatCell[I].isBottom(), Partial = LatCell[I].isPartial();
+  bool Bits = tracksBits(I), Null = tracksNull(I);
+  if (Bottom && !Partial &&
+      (!Bits || !BitCell.count(I) || BitCell[I].isUnknown()) &&
+      (!Null || getNullness(I) == MaybeNull))
     return;
-  LatticeElem ret;
-  if (I->isBinaryOp())
+  LatticeElem ret = bottom;
+  if (Bottom && !Partial)
+    ; // only the bit-level lattice may still change
+  else if (I->isBinaryOp())
     ret = evalBinaryOp(dyn_cast<BinaryOperator>(I));
   else if (I->isUnaryOp())
     ret = evalUnaryOp(dyn_cast<UnaryOperator>(I));
@@ -158,6 +444,30 @@ void UnitSCCP::visitInstruction(Instruction *I) {
     case Instruction::PHI:
       ret = evalPhi(dyn_cast<PHINode>(I));
       break;
+    case Instruction::Load:
+      ret = evalLoad(dyn_cast<LoadInst>(I));
+      break;
+    case Instruction::Call:
+      ret = evalCall(dyn_cast<CallInst>(I));
+      break;
+    case Instruction::ExtractValue:
+      ret = evalExtractValue(dyn_cast<ExtractValueInst>(I));
+      break;
+    case Instruction::InsertValue:
+      ret = evalInsertValue(dyn_cast<InsertValueInst>(I));
+      break;
+    case Instruction::ExtractElement:
+      ret = evalExtractElement(dyn_cast<ExtractElementInst>(I));
+      break;
+    case Instruction::InsertElement:
+      ret = evalInsertElement(dyn_cast<InsertElementInst>(I));
+      break;
+    case Instruction::ShuffleVector:
+      ret = evalShuffleVector(dyn_cast<ShuffleVectorInst>(I));
+      break;
+    case Instruction::Freeze:
+      ret = evalFreeze(dyn_cast<FreezeInst>(I));
+      break;
     // case Instruction::Ret:
     //   ret = evalRet(dyn_cast<ReturnInst>(I));
     //   break;
@@ -165,129 +475,800 @@ void UnitSCCP::visitInstruction(Instruction *I) {
       ret = evalUnsupported(I);
     }
   }
-  dbgs() << "visitInstr: Evaluate" << *I << " of value " << LV.info()
-         << " with " << ret.info() << "\n";
+  if (ret.isBottom() && isa<FixedVectorType>(I->getType()))
+    ret = evalLanewise(I, ret);
+  bool Changed = false, FromBits = false;
+  if (Bits) {
+    Changed = updateBits(I, evalBits(I));
+    auto &Known = BitCell[I];
+    if (ret.isBottom() && Known.isConstant()) {
+      UNIT_TRACE(TraceDecision,
+                 dbgs() << "visitInstr: Bits fully known for" << *I << "\n");
+      ret = Known.getConstant();
+      FromBits = true;
+    }
+  }
+  if (Null && updateNull(I, evalNull(I)))
+    Changed = true;
+  auto &LV = LatCell[I];
+  UNIT_TRACE(TraceVisit, dbgs() << "visitInstr: Evaluate" << *I
+                                << " of value " << LV.info() << " with "
+                                << ret.info() << "\n");
+  bool WasConstant = LV.isConstant();
   if (LV.meet(ret)) {
-    dbgs() << "visitInstr: Changing to " << LV.info() << "\n";
+    UNIT_TRACE(TraceDecision,
+               dbgs() << "visitInstr: Changing" << *I << " to " << LV.info()
+                      << "\n");
+    Changed = true;
+  }
+  // A fold, once per instruction, not per visit that confirms it
+  if (FromBits && !WasConstant && LV.isConstant())
+    IBits++;
+  if (Changed)
     addSSAOutEdges(I);
+}
+/// Constants the lattice may hold: plain data, and addresses of globals at a
+/// constant offset. Any other ConstantExpr (ptrtoint of a global, arithmetic
+/// on addresses, trapping division) is unfolded work that would only be
+/// written back into the IR, so it counts as bottom.
+static bool isFoldedConstant(Constant *C) {
+  if (auto CE = dyn_cast<ConstantExpr>(C)) {
+    switch (CE->getOpcode()) {
+    case Instruction::GetElementPtr:
+      for (auto &U : drop_begin(CE->operands()))
+        if (!isa<ConstantInt>(U.get()))
+          return false;
+      return isFoldedConstant(CE->getOperand(0));
+    case Instruction::BitCast:
+    case Instruction::AddrSpaceCast:
+      return CE->getType()->isPointerTy() &&
+             isFoldedConstant(CE->getOperand(0));
+    default:
+      return false;
+    }
   }
+  if (isa<ConstantAggregate>(C))
+    for (auto &U : C->operands())
+      if (!isFoldedConstant(cast<Constant>(U.get())))
+        return false;
+  return true;
+}
+LatticeElem SCCPSolver::folded(Constant *C) {
+  if (!C || !isFoldedConstant(C))
+    return bottom;
+  return C;
 }
-LatticeElem UnitSCCP::evalBinaryOp(BinaryOperator *I) {
-  auto LV1 = getLattice(I->getOperand(0)), LV2 = getLattice(I->getOperand(1));
+LatticeElem SCCPSolver::evalBinaryOp(BinaryOperator *I) {
+  auto BB = I->getParent();
+  auto LV1 = getLatticeAt(I->getOperand(0), BB),
+       LV2 = getLatticeAt(I->getOperand(1), BB);
   assert(!LV1.isTop() && !LV2.isTop());
   if (LV1.isBottom() || LV2.isBottom()) {
     return bottom;
   } else {
-    return ConstantExpr::get(I->getOpcode(), LV1.Val, LV2.Val);
+    LatticeElem Res;
+    if (foldBinary(I->getOpcode(), LV1, LV2, Res))
+      return Res;
+    return folded(ConstantFoldBinaryOpOperands(
+        I->getOpcode(), LV1.get(I->getOperand(0)->getType()),
+        LV2.get(I->getOperand(1)->getType()), *DL));
   }
 }
-LatticeElem UnitSCCP::evalUnaryOp(UnaryOperator *I) {
-  auto LV1 = getLattice(I->getOperand(0));
+LatticeElem SCCPSolver::evalUnaryOp(UnaryOperator *I) {
+  auto LV1 = getLatticeAt(I->getOperand(0), I->getParent());
   if (LV1.isBottom()) {
     return bottom;
   } else {
-    return ConstantExpr::get(I->getOpcode(), LV1.Val);
+    LatticeElem Res;
+    if (foldUnary(I->getOpcode(), LV1, Res))
+      return Res;
+    return folded(ConstantFoldUnaryOpOperand(
+        I->getOpcode(), LV1.get(I->getOperand(0)->getType()), *DL));
   }
 }
-LatticeElem UnitSCCP::evalCast(CastInst *I) {
-  auto LV1 = getLattice(I->getOperand(0));
+LatticeElem SCCPSolver::evalCast(CastInst *I) {
+  auto LV1 = getLatticeAt(I->getOperand(0), I->getParent());
   if (LV1.isBottom()) {
     return bottom;
   } else {
-    return ConstantExpr::getCast(I->getOpcode(), LV1.Val, I->getType());
+    LatticeElem Res;
+    if (foldCast(I->getOpcode(), LV1, I->getType(), Res))
+      return Res;
+    return folded(ConstantFoldCastOperand(I->getOpcode(),
+                                          LV1.get(I->getSrcTy()),
+                                          I->getType(), *DL));
   }
 }
-LatticeElem UnitSCCP::evalCmp(CmpInst *I) {
-  auto LV1 = getLattice(I->getOperand(0)), LV2 = getLattice(I->getOperand(1));
+LatticeElem SCCPSolver::evalCmp(CmpInst *I) {
+  auto BB = I->getParent();
+  auto LV1 = getLatticeAt(I->getOperand(0), BB),
+       LV2 = getLatticeAt(I->getOperand(1), BB);
   assert(!LV1.isTop() && !LV2.isTop());
   // dbgs() << "CMP: Meeting" << LV1.info() << LV2.info() << "\n";
   if (LV1.isBottom() || LV2.isBottom()) {
+    auto Cmp = dyn_cast<ICmpInst>(I);
+    if (Cmp && NullnessMode && Cmp->getOperand(0)->getType()->isPointerTy()) {
+      auto Res = evalCmpNull(Cmp);
+      if (!Res)
+        return bottom;
+      INull++;
+      return APInt(1, *Res);
+    }
+    if (!Cmp || !Cmp->getOperand(0)->getType()->isIntegerTy())
+      return bottom;
+    // Decide the comparison from the ranges dominating branches imply
+    auto CR1 = getRangeAt(I->getOperand(0), BB),
+         CR2 = getRangeAt(I->getOperand(1), BB);
+    if (CR1.icmp(Cmp->getPredicate(), CR2))
+      return APInt(1, 1);
+    if (CR1.icmp(Cmp->getInversePredicate(), CR2))
+      return APInt(1, 0);
     return bottom;
   } else {
-    return ConstantExpr::getCompare(I->getPredicate(), LV1.Val, LV2.Val);
+    LatticeElem Res;
+    if (foldCmp(I->getPredicate(), LV1, LV2, Res))
+      return Res;
+    auto Ty = I->getOperand(0)->getType();
+    return folded(ConstantFoldCompareInstOperands(
+        I->getPredicate(), LV1.get(Ty), LV2.get(Ty), *DL, TLI));
   }
 }
-LatticeElem UnitSCCP::evalSelect(SelectInst *I) {
-  auto LVC = getLattice(I->getCondition());
-  auto LV1 = getLattice(I->getTrueValue()),
-       LV2 = getLattice(I->getFalseValue());
+LatticeElem SCCPSolver::evalSelect(SelectInst *I) {
+  auto BB = I->getParent();
+  auto LVC = getLatticeAt(I->getCondition(), BB);
+  auto LV1 = getLatticeAt(I->getTrueValue(), BB),
+       LV2 = getLatticeAt(I->getFalseValue(), BB);
   if (LVC.isBottom())
     return LV1 ^ LV2;
+  if (LVC.isUndef())
+    return LV1; // like a branch on undef
   else {
-    if (LVC.Val->isNullValue())
+    if (LVC.isNullValue())
       return LV2;
-    if (LVC.Val->isAllOnesValue())
+    if (LVC.isAllOnesValue())
       return LV1;
-    assert(false);
+    return bottom; // mixed vector conditions are left to evalLanewise
   }
 }
-LatticeElem UnitSCCP::evalGetElementPtr(GetElementPtrInst *I) {
+LatticeElem SCCPSolver::evalGetElementPtr(GetElementPtrInst *I) {
   auto Ptr = getLattice(I->getPointerOperand());
   if (Ptr.isBottom())
     return bottom;
   else {
-    vector<Constant *> Idx;
+    vector<Constant *> Ops = {Ptr.get(I->getPointerOperandType())};
     for (auto &U : I->indices()) {
       auto V = U.get();
-      auto LV = getLattice(V);
+      auto LV = getLatticeAt(V, I->getParent());
       if (LV.isBottom()) {
         return bottom;
       }
-      Idx.push_back(LV.Val);
-    }
-    auto AR = makeArrayRef(Idx);
-    return ConstantExpr::getGetElementPtr(I->getSourceElementType(), Ptr.Val,
-                                          AR);
-  }
-}
-LatticeElem UnitSCCP::evalPhi(PHINode *I) {
-  LatticeElem ret;
-  for (uint i = 0, n = I->getNumOperands(); i < n; i++) {
-    auto V = I->getIncomingValue(i);
-    auto PredBB = I->getIncomingBlock(i);
-    Edge E(PredBB, I->getParent());
-    if (ExecFlag[E]) {
-      dbgs() << "PHI: Meeting" << getLattice(V).info() << "\n";
-      ret.meet(getLattice(V));
+      Ops.push_back(LV.get(V->getType()));
     }
+    return folded(ConstantFoldInstOperands(I, Ops, *DL, TLI));
   }
-  dbgs() << "PHI: Eval to " << ret.info() << "\n";
+}
+LatticeElem SCCPSolver::evalPhi(PHINode *I) {
+  // Incoming values are refined by the facts of their edge
+  auto ret = joinIncoming(I);
+  UNIT_TRACE(TraceVisit, dbgs() << "PHI: Eval to " << ret.info() << "\n");
   return ret;
 }
-void UnitSCCP::addSSAOutEdges(Instruction *I) {
-  for (auto U : I->users()) {
-    if (auto J = dyn_cast<Instruction>(U)) {
-      Edge E(I->getParent(), J->getParent());
-      if (FlowMark[J->getParent()]) {
-        dbgs() << "SSAOut: Push" << *J << " in SSA Queue, due to" << *I << "\n";
-        if (!InSSAQ[J]) {
-          InSSAQ[J] = true;
-          SSAQ.push(J);
+bool SCCPSolver::tracksBits(Instruction *I) {
+  return KnownBitsMode && I->getType()->isIntegerTy();
+}
+KnownBits SCCPSolver::getKnownBits(Value *V) {
+  unsigned BW = V->getType()->getIntegerBitWidth();
+  if (!isa<Constant>(V) && !LatCell.count(V))
+    return KnownBits(BW);
+  auto LV = getLattice(V);
+  if (LV.isConstant()) {
+    if (LV.isInt())
+      return KnownBits::makeConstant(LV.Int);
+    return KnownBits(BW);
+  }
+  auto Known = BitCell.find(V);
+  if (LV.isTop() || !Known)
+    return KnownBits(BW);
+  return *Known;
+}
+/// Transfer function of the bit-level lattice. Opcodes without a rule know
+/// nothing beyond what the constant lattice already says.
+KnownBits SCCPSolver::evalBits(Instruction *I) {
+  unsigned BW = I->getType()->getIntegerBitWidth();
+  auto Op = [&](unsigned i) { return getKnownBits(I->getOperand(i)); };
+  switch (I->getOpcode()) {
+  case Instruction::And:
+    return Op(0) & Op(1);
+  case Instruction::Or:
+    return Op(0) | Op(1);
+  case Instruction::Xor:
+    return Op(0) ^ Op(1);
+  case Instruction::Shl:
+    return KnownBits::shl(Op(0), Op(1));
+  case Instruction::LShr:
+    return KnownBits::lshr(Op(0), Op(1));
+  case Instruction::AShr:
+    return KnownBits::ashr(Op(0), Op(1));
+  case Instruction::ZExt:
+    return Op(0).zext(BW);
+  case Instruction::SExt:
+    return Op(0).sext(BW);
+  case Instruction::Trunc:
+    return Op(0).trunc(BW);
+  case Instruction::ICmp:
+    if (auto Res = evalCmpBits(cast<ICmpInst>(I)))
+      return KnownBits::makeConstant(APInt(1, *Res));
+    return KnownBits(BW);
+  case Instruction::Select: {
+    auto LVC = getLattice(cast<SelectInst>(I)->getCondition());
+    if (LVC.isConstant())
+      return Op(LVC.isNullValue() ? 2 : 1);
+    return KnownBits::commonBits(Op(1), Op(2));
+  }
+  case Instruction::PHI: {
+    auto Phi = cast<PHINode>(I);
+    Optional<KnownBits> Known;
+    for (uint i = 0, n = Phi->getNumIncomingValues(); i < n; i++) {
+      if (!isEdgeExecutable(Phi->getIncomingBlock(i), Phi->getParent()))
+        continue;
+      auto K = getKnownBits(Phi->getIncomingValue(i));
+      Known = Known ? KnownBits::commonBits(*Known, K) : K;
+    }
+    return Known ? *Known : KnownBits(BW);
+  }
+  default:
+    return KnownBits(BW);
+  }
+}
+Optional<bool> SCCPSolver::evalCmpBits(ICmpInst *I) {
+  if (!I->getOperand(0)->getType()->isIntegerTy())
+    return None;
+  auto L = getKnownBits(I->getOperand(0)), R = getKnownBits(I->getOperand(1));
+  switch (I->getPredicate()) {
+  case CmpInst::ICMP_EQ:
+    return KnownBits::eq(L, R);
+  case CmpInst::ICMP_NE:
+    return KnownBits::ne(L, R);
+  case CmpInst::ICMP_UGT:
+    return KnownBits::ugt(L, R);
+  case CmpInst::ICMP_UGE:
+    return KnownBits::uge(L, R);
+  case CmpInst::ICMP_ULT:
+    return KnownBits::ult(L, R);
+  case CmpInst::ICMP_ULE:
+    return KnownBits::ule(L, R);
+  case CmpInst::ICMP_SGT:
+    return KnownBits::sgt(L, R);
+  case CmpInst::ICMP_SGE:
+    return KnownBits::sge(L, R);
+  case CmpInst::ICMP_SLT:
+    return KnownBits::slt(L, R);
+  case CmpInst::ICMP_SLE:
+    return KnownBits::sle(L, R);
+  default:
+    return None;
+  }
+}
+/// Meet \p Known into the bit cell of \p I; returns true if the bits users
+/// see changed. A missing cell reads as all bits unknown, so filling it with
+/// nothing known is no change.
+bool SCCPSolver::updateBits(Instruction *I, KnownBits Known) {
+  if (Known.hasConflict()) // poison shift amounts and the like
+    Known.resetAll();
+  auto Cell = BitCell.find(I);
+  if (!Cell) {
+    BitCell[I] = Known;
+    return !Known.isUnknown();
+  }
+  auto Merged = KnownBits::commonBits(*Cell, Known);
+  if (Merged.Zero == Cell->Zero && Merged.One == Cell->One)
+    return false;
+  *Cell = Merged;
+  return true;
+}
+bool SCCPSolver::tracksNull(Instruction *I) {
+  return NullnessMode && I->getType()->isPointerTy();
+}
+/// Record the pointers every load and store goes through. Each base an
+/// inbounds or zero-offset GEP chain reaches is non-null as well, since the
+/// access would be undefined behavior otherwise.
+void SCCPSolver::collectDerefs(Function &F) {
+  for (auto &BB : F) {
+    auto N = DT->getNode(&BB);
+    if (!N)
+      continue;
+    for (auto &I : BB) {
+      Value *Ptr = nullptr;
+      if (auto LI = dyn_cast<LoadInst>(&I)) {
+        if (!LI->isVolatile())
+          Ptr = LI->getPointerOperand();
+      } else if (auto SI = dyn_cast<StoreInst>(&I)) {
+        if (!SI->isVolatile())
+          Ptr = SI->getPointerOperand();
+      }
+      if (!Ptr ||
+          NullPointerIsDefined(&F, Ptr->getType()->getPointerAddressSpace()))
+        continue;
+      while (true) {
+        Derefs[Ptr].add(N, &I);
+        if (auto GEP = dyn_cast<GEPOperator>(Ptr)) {
+          if (!GEP->isInBounds() && !GEP->hasAllZeroIndices())
+            break;
+          Ptr = GEP->getPointerOperand();
+        } else if (auto BC = dyn_cast<BitCastOperator>(Ptr)) {
+          Ptr = BC->getOperand(0);
+        } else {
+          break;
         }
-      } else {
-        dbgs() << "SSAOut: Not push" << *J << " in SSA Queue, due to "
-               << edgeInfo(E) << "'s sink not currently executable\n";
       }
     }
   }
+  // Later accesses in a block add nothing to the first
+  for (auto Ptr : Derefs.keys())
+    Derefs[Ptr].link([](Instruction *, Instruction *) {});
 }
-string LatticeElem::getStatus(const LatticeStatus L) {
-  switch (L) {
-  case constant:
-    return "Constant";
-  case top:
-    return "Top (may be constant)";
-  case bottom:
-    return "Bottom (cannot be constant)";
+/// Whether a load or store through \p V runs on every path to \p At
+bool SCCPSolver::isDereferencedAt(Value *V, Instruction *At) {
+  auto AtBB = At->getParent();
+  auto Ds = Derefs.find(V);
+  auto N = Ds ? DT->getNode(AtBB) : nullptr;
+  int i = N ? Ds->find(N) : -1;
+  // An access in At's own block only counts if it comes first
+  if (i >= 0 && Ds->block(i) == AtBB && !(*Ds)[i]->comesBefore(At))
+    i = Ds->parent(i);
+  return i >= 0;
+}
+/// Nullness of \p V that holds everywhere in the function
+Nullness SCCPSolver::getNullness(Value *V) {
+  if (auto C = dyn_cast<Constant>(V)) {
+    if (C->isNullValue())
+      return KnownNull;
+    auto GV = dyn_cast<GlobalValue>(C->stripInBoundsOffsets());
+    if (GV && !GV->hasExternalWeakLinkage() &&
+        !NullPointerIsDefined(nullptr, GV->getAddressSpace()))
+      return KnownNonNull;
+    return MaybeNull;
   }
-  return "?";
+  if (auto A = dyn_cast<Argument>(V))
+    return A->hasNonNullAttr() ? KnownNonNull : MaybeNull;
+  auto N = NullCell.find(V);
+  return N ? *N : NullTop;
+}
+/// Nullness of \p V at \p At, or on the edge \p From -> At's block, with
+/// null checks of dominating branches and earlier accesses through \p V
+Nullness SCCPSolver::getNullnessAt(Value *V, Instruction *At,
+                                   BasicBlock *From) {
+  auto N = getNullness(V);
+  if (N != MaybeNull)
+    return N;
+  auto CR = getRangeAt(V, At->getParent(), From);
+  if (CR.isSingleElement() && CR.getSingleElement()->isZero())
+    return KnownNull;
+  if (!CR.contains(APInt::getZero(CR.getBitWidth())) ||
+      isDereferencedAt(V, From ? From->getTerminator() : At))
+    return KnownNonNull;
+  return MaybeNull;
 }
-string LatticeElem::info() {
-  string str;
-  raw_string_ostream os(str);
-  os << getStatus(Status);
-  if (isConstant()) {
-    os << " (" << *Val << ")";
+/// Transfer function of the nullness lattice
+Nullness SCCPSolver::evalNull(Instruction *I) {
+  auto F = I->getFunction();
+  unsigned AS = I->getType()->getPointerAddressSpace();
+  switch (I->getOpcode()) {
+  case Instruction::Alloca:
+    return NullPointerIsDefined(F, AS) ? MaybeNull : KnownNonNull;
+  case Instruction::GetElementPtr: {
+    auto GEP = cast<GetElementPtrInst>(I);
+    auto Base = getNullnessAt(GEP->getPointerOperand(), I);
+    if (Base == NullTop || GEP->hasAllZeroIndices())
+      return Base;
+    if (Base == KnownNonNull && GEP->isInBounds() &&
+        !NullPointerIsDefined(F, AS))
+      return KnownNonNull;
+    return MaybeNull;
+  }
+  case Instruction::BitCast:
+    return getNullnessAt(I->getOperand(0), I);
+  case Instruction::Select: {
+    auto LVC = getLattice(cast<SelectInst>(I)->getCondition());
+    if (LVC.isConstant() && !LVC.numElems())
+      return getNullnessAt(I->getOperand(LVC.isNullValue() ? 2 : 1), I);
+    return meetNull(getNullnessAt(I->getOperand(1), I),
+                    getNullnessAt(I->getOperand(2), I));
+  }
+  case Instruction::PHI: {
+    auto Phi = cast<PHINode>(I);
+    auto N = NullTop;
+    for (unsigned i = 0, n = Phi->getNumIncomingValues(); i < n; i++) {
+      auto PredBB = Phi->getIncomingBlock(i);
+      if (isEdgeExecutable(PredBB, Phi->getParent()))
+        N = meetNull(N, getNullnessAt(Phi->getIncomingValue(i), I, PredBB));
+    }
+    return N;
   }
-  return str;
-}
\ No newline at end of file
+  case Instruction::Load:
+    return I->hasMetadata(LLVMContext::MD_nonnull) ? KnownNonNull : MaybeNull;
+  case Instruction::Call: {
+    auto CB = cast<CallBase>(I);
+    if (CB->hasRetAttr(Attribute::NonNull) ||
+        (CB->getRetDereferenceableBytes() && !NullPointerIsDefined(F, AS)))
+      return KnownNonNull;
+    return MaybeNull;
+  }
+  default:
+    return MaybeNull;
+  }
+}
+/// Decide a pointer equality from the nullness of both sides
+Optional<bool> SCCPSolver::evalCmpNull(ICmpInst *I) {
+  if (!I->isEquality() || I->getType()->isVectorTy())
+    return None;
+  auto L = getNullnessAt(I->getOperand(0), I),
+       R = getNullnessAt(I->getOperand(1), I);
+  bool Eq = I->getPredicate() == CmpInst::ICMP_EQ;
+  if (L == KnownNull && R == KnownNull)
+    return Eq;
+  if ((L == KnownNull && R == KnownNonNull) ||
+      (L == KnownNonNull && R == KnownNull))
+    return !Eq;
+  return None;
+}
+/// Meet \p N into the nullness cell of \p I; returns true if it changed
+bool SCCPSolver::updateNull(Instruction *I, Nullness N) {
+  auto Old = getNullness(I);
+  auto New = meetNull(Old, N);
+  NullCell[I] = New;
+  return New != Old;
+}
+LatticeElem SCCPSolver::evalLoad(LoadInst *I) {
+  if (auto S = SlotOf.find(I)) {
+    auto &LV = MemCell[*S];
+    // Nothing executable has written the slot yet: it holds undef
+    if (LV.isTop())
+      return UndefValue::get(I->getType());
+    return LV;
+  }
+  if (I->isVolatile())
+    return bottom;
+  auto Ptr = getLatticeAt(I->getPointerOperand(), I->getParent());
+  if (Ptr.isBottom())
+    return bottom;
+  // Only folds from constant globals with a definitive initializer
+  auto LV = folded(ConstantFoldLoadFromConstPtr(
+      Ptr.get(I->getPointerOperandType()), I->getType(), *DL));
+  if (LV.isConstant())
+    ILoad++;
+  return LV;
+}
+LatticeElem SCCPSolver::evalExtractElement(ExtractElementInst *I) {
+  auto BB = I->getParent();
+  auto Vec = getLatticeAt(I->getVectorOperand(), BB),
+       Idx = getLatticeAt(I->getIndexOperand(), BB);
+  auto VTy = dyn_cast<FixedVectorType>(I->getVectorOperandType());
+  if (!VTy || !Idx.isInt())
+    return bottom;
+  if (Idx.Int.uge(VTy->getNumElements()))
+    return PoisonValue::get(I->getType());
+  return Vec.getElem(Idx.Int.getZExtValue());
+}
+LatticeElem SCCPSolver::evalInsertElement(InsertElementInst *I) {
+  auto BB = I->getParent();
+  auto Vec = getLatticeAt(I->getOperand(0), BB),
+       Elt = getLatticeAt(I->getOperand(1), BB),
+       Idx = getLatticeAt(I->getOperand(2), BB);
+  auto VTy = dyn_cast<FixedVectorType>(I->getType());
+  if (!VTy || !Idx.isInt())
+    return bottom;
+  unsigned N = VTy->getNumElements();
+  if (Idx.Int.uge(N))
+    return PoisonValue::get(VTy);
+  vector<LatticeElem> Lanes;
+  for (unsigned i = 0; i < N; i++)
+    Lanes.push_back(i == Idx.Int.getZExtValue() ? Elt : Vec.getElem(i));
+  return LatticeElem::fromElems(std::move(Lanes), VTy);
+}
+LatticeElem SCCPSolver::evalShuffleVector(ShuffleVectorInst *I) {
+  auto BB = I->getParent();
+  auto VTy = dyn_cast<FixedVectorType>(I->getType());
+  auto SrcTy = dyn_cast<FixedVectorType>(I->getOperand(0)->getType());
+  if (!VTy || !SrcTy)
+    return bottom;
+  auto A = getLatticeAt(I->getOperand(0), BB),
+       B = getLatticeAt(I->getOperand(1), BB);
+  int NS = SrcTy->getNumElements();
+  vector<LatticeElem> Lanes;
+  for (int M : I->getShuffleMask()) {
+    if (M == UndefMaskElem)
+      Lanes.push_back(UndefValue::get(VTy->getElementType()));
+    else
+      Lanes.push_back(M < NS ? A.getElem(M) : B.getElem(M - NS));
+  }
+  return LatticeElem::fromElems(std::move(Lanes), VTy);
+}
+/// Evaluate an element-wise vector instruction lane by lane, so lanes that are
+/// constant fold even when an operand vector is only partially known
+LatticeElem SCCPSolver::evalLanewise(Instruction *I, const LatticeElem &Whole) {
+  if (!I->isBinaryOp() && !I->isUnaryOp() && !I->isCast() &&
+      !isa<CmpInst>(I) && !isa<SelectInst>(I))
+    return Whole;
+  vector<LatticeElem> Ops;
+  bool AnyLanes = false;
+  for (auto &U : I->operands()) {
+    Ops.push_back(getLatticeAt(U.get(), I->getParent()));
+    AnyLanes |= Ops.back().numElems() > 0;
+  }
+  if (!AnyLanes)
+    return Whole;
+  vector<LatticeElem> Lanes;
+  auto VTy = cast<FixedVectorType>(I->getType());
+  for (unsigned i = 0, n = VTy->getNumElements(); i < n; i++) {
+    vector<LatticeElem> L;
+    for (unsigned k = 0; k < Ops.size(); k++) {
+      bool IsVector = I->getOperand(k)->getType()->isVectorTy();
+      L.push_back(IsVector ? Ops[k].getElem(i) : Ops[k]);
+    }
+    Lanes.push_back(evalLane(I, L));
+  }
+  return LatticeElem::fromElems(std::move(Lanes), I->getType());
+}
+LatticeElem SCCPSolver::evalLane(Instruction *I, vector<LatticeElem> &L) {
+  if (isa<SelectInst>(I) && L[0].isUndef())
+    return L[1];
+  if (isa<SelectInst>(I) && !L[0].isConstant())
+    return L[1] ^ L[2];
+  for (auto &E : L)
+    if (!E.isConstant() && !E.isUndef())
+      return bottom;
+  auto Ty = [&](unsigned k) {
+    return I->getOperand(k)->getType()->getScalarType();
+  };
+  LatticeElem Res;
+  if (isa<SelectInst>(I))
+    return L[0].isNullValue() ? L[2] : L[1];
+  if (I->isBinaryOp()) {
+    if (foldBinary(I->getOpcode(), L[0], L[1], Res))
+      return Res;
+    return folded(ConstantFoldBinaryOpOperands(I->getOpcode(), L[0].get(Ty(0)),
+                                               L[1].get(Ty(1)), *DL));
+  }
+  if (I->isUnaryOp()) {
+    if (foldUnary(I->getOpcode(), L[0], Res))
+      return Res;
+    return folded(
+        ConstantFoldUnaryOpOperand(I->getOpcode(), L[0].get(Ty(0)), *DL));
+  }
+  auto EltTy = I->getType()->getScalarType();
+  if (I->isCast()) {
+    if (foldCast(I->getOpcode(), L[0], EltTy, Res))
+      return Res;
+    return folded(
+        ConstantFoldCastOperand(I->getOpcode(), L[0].get(Ty(0)), EltTy, *DL));
+  }
+  auto Pred = cast<CmpInst>(I)->getPredicate();
+  if (foldCmp(Pred, L[0], L[1], Res))
+    return Res;
+  return folded(ConstantFoldCompareInstOperands(Pred, L[0].get(Ty(0)),
+                                                L[1].get(Ty(1)), *DL, TLI));
+}
+/// Fold calls to pure library functions and intrinsics whose arguments are all
+/// constant
+LatticeElem SCCPSolver::evalCall(CallInst *I) {
+  auto Callee = I->getCalledFunction();
+  if (!Callee || I->getType()->isVoidTy() || !canConstantFoldCallTo(I, Callee))
+    return bottom;
+  vector<Constant *> Args;
+  for (auto &U : I->args()) {
+    auto LV = getLatticeAt(U.get(), I->getParent());
+    if (LV.isBottom()) {
+      if (auto WO = dyn_cast<WithOverflowInst>(I))
+        return evalOverflow(WO);
+      return bottom;
+    }
+    Args.push_back(LV.get(U->getType()));
+  }
+  auto LV = folded(ConstantFoldCall(I, Callee, Args, TLI));
+  if (LV.isConstant())
+    ICall++;
+  return LV;
+}
+/// Freezing undef picks one value, and every use must see that same value:
+/// zero, as good as any. Defined constants pass through: integer and FP
+/// scalars always are, other constants unless they hold undef or poison.
+LatticeElem SCCPSolver::evalFreeze(FreezeInst *I) {
+  auto LV = getLatticeAt(I->getOperand(0), I->getParent());
+  if (LV.isUndef())
+    return Constant::getNullValue(I->getType());
+  if (LV.isConstant() &&
+      (!LV.Val || isGuaranteedNotToBeUndefOrPoison(LV.Val)))
+    return LV;
+  return bottom;
+}
+/// Aggregates are tracked field by field, so a constant field survives
+/// insertion into and extraction from an otherwise unknown aggregate
+LatticeElem SCCPSolver::evalExtractValue(ExtractValueInst *I) {
+  auto LV = getLatticeAt(I->getAggregateOperand(), I->getParent());
+  for (auto Idx : I->getIndices()) {
+    if (!LV.numElems())
+      return bottom;
+    LV = LV.getElem(Idx);
+  }
+  return LV;
+}
+LatticeElem SCCPSolver::evalInsertValue(InsertValueInst *I) {
+  auto BB = I->getParent();
+  return insertField(getLatticeAt(I->getAggregateOperand(), BB), I->getType(),
+                     I->getIndices(),
+                     getLatticeAt(I->getInsertedValueOperand(), BB));
+}
+/// \p Agg of type \p Ty with the field at \p Idx replaced by \p Val
+LatticeElem SCCPSolver::insertField(const LatticeElem &Agg, Type *Ty,
+                                    ArrayRef<unsigned> Idx,
+                                    const LatticeElem &Val) {
+  if (Idx.empty())
+    return Val;
+  unsigned N = isa<StructType>(Ty) ? Ty->getStructNumElements()
+                                   : Ty->getArrayNumElements();
+  vector<LatticeElem> Fields;
+  for (unsigned i = 0; i < N; i++)
+    Fields.push_back(Agg.getElem(i));
+  Fields[Idx[0]] =
+      insertField(Fields[Idx[0]], LatticeElem::getElemType(Ty, Idx[0]),
+                  Idx.drop_front(), Val);
+  return LatticeElem::fromElems(std::move(Fields), Ty);
+}
+/// The overflow bit of an arithmetic with overflow intrinsic whose operands
+/// are not both constant, from the ranges the predicates give them
+LatticeElem SCCPSolver::evalOverflow(WithOverflowInst *I) {
+  // Branch facts only give ranges of scalars
+  if (!I->getLHS()->getType()->isIntegerTy())
+    return bottom;
+  auto BB = I->getParent();
+  auto CR1 = getRangeAt(I->getLHS(), BB), CR2 = getRangeAt(I->getRHS(), BB);
+  auto OR = ConstantRange::OverflowResult::MayOverflow;
+  bool Signed = I->isSigned();
+  switch (I->getBinaryOp()) {
+  case Instruction::Add:
+    OR = Signed ? CR1.signedAddMayOverflow(CR2)
+                : CR1.unsignedAddMayOverflow(CR2);
+    break;
+  case Instruction::Sub:
+    OR = Signed ? CR1.signedSubMayOverflow(CR2)
+                : CR1.unsignedSubMayOverflow(CR2);
+    break;
+  case Instruction::Mul:
+    if (!Signed)
+      OR = CR1.unsignedMulMayOverflow(CR2);
+    break;
+  default:
+    break;
+  }
+  if (OR == ConstantRange::OverflowResult::MayOverflow)
+    return bottom;
+  bool Overflows = OR != ConstantRange::OverflowResult::NeverOverflows;
+  IOvf++;
+  return LatticeElem::fromElems(
+      {bottom, LatticeElem(APInt(1, Overflows))}, I->getType());
+}
+/// Track the contents of \p AI if it never escapes and every access is at a
+/// constant offset that overlaps no differently typed access
+void SCCPSolver::initSlots(AllocaInst *AI) {
+  vector<pair<Instruction *, int64_t>> Accesses;
+  if (!AI->isStaticAlloca() || !collectSlotAccesses(AI, 0, Accesses))
+    return;
+  map<int64_t, Type *> Types;
+  for (auto &A : Accesses) {
+    Type *Ty = nullptr;
+    if (auto LI = dyn_cast<LoadInst>(A.first))
+      Ty = LI->getType();
+    else if (auto SI = dyn_cast<StoreInst>(A.first))
+      Ty = SI->getValueOperand()->getType();
+    else
+      continue;
+    auto Res = Types.emplace(A.second, Ty);
+    if (!Res.second && Res.first->second != Ty)
+      return;
+  }
+  int64_t End = INT64_MIN;
+  for (auto &T : Types) {
+    if (T.first < End)
+      return;
+    End = T.first + (int64_t)DL->getTypeStoreSize(T.second).getFixedSize();
+  }
+  for (auto &A : Accesses) {
+    Slot S(AI, A.second);
+    SlotOf[A.first] = S;
+    if (auto LI = dyn_cast<LoadInst>(A.first))
+      SlotLoads[S].push_back(LI);
+  }
+  SlotTypes[AI] = std::move(Types);
+  UNIT_TRACE(TraceDecision, dbgs() << "Slots: Tracking" << *AI << "\n");
+}
+bool SCCPSolver::collectSlotAccesses(
+    Value *Ptr, int64_t Offset,
+    vector<pair<Instruction *, int64_t>> &Accesses) {
+  for (auto U : Ptr->users()) {
+    if (auto LI = dyn_cast<LoadInst>(U)) {
+      if (LI->isVolatile() || LI->getType()->isAggregateType())
+        return false;
+      Accesses.push_back({LI, Offset});
+    } else if (auto SI = dyn_cast<StoreInst>(U)) {
+      if (SI->isVolatile() || SI->getValueOperand() == Ptr ||
+          SI->getValueOperand()->getType()->isAggregateType())
+        return false;
+      Accesses.push_back({SI, Offset});
+    } else if (auto GEP = dyn_cast<GetElementPtrInst>(U)) {
+      APInt Off(DL->getIndexTypeSizeInBits(GEP->getType()), 0);
+      if (!GEP->accumulateConstantOffset(*DL, Off) ||
+          !collectSlotAccesses(GEP, Offset + Off.getSExtValue(), Accesses))
+        return false;
+    } else if (auto BC = dyn_cast<BitCastInst>(U)) {
+      if (!collectSlotAccesses(BC, Offset, Accesses))
+        return false;
+    } else if (auto II = dyn_cast<IntrinsicInst>(U)) {
+      if (II->isLifetimeStartOrEnd())
+        continue;
+      // Initialization of the whole slot by memset or memcpy of a constant
+      auto MI = dyn_cast<MemIntrinsic>(II);
+      if (!MI || MI->isVolatile() || MI->getRawDest() != Ptr || Offset != 0 ||
+          !isa<ConstantInt>(MI->getLength()))
+        return false;
+      if (auto MT = dyn_cast<MemTransferInst>(MI)) {
+        auto Src = MT->getSource();
+        auto GV = dyn_cast<GlobalVariable>(getUnderlyingObject(Src));
+        if (!GV || !GV->isConstant() || !GV->hasDefinitiveInitializer() ||
+            !isa<Constant>(Src))
+          return false;
+      } else if (!isa<MemSetInst>(MI) ||
+                 !isa<ConstantInt>(MI->getArgOperand(1))) {
+        return false;
+      }
+      Accesses.push_back({MI, Offset});
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+void SCCPSolver::visitStore(StoreInst *I) {
+  auto S = SlotOf.find(I);
+  if (!S)
+    return;
+  meetSlot(*S, getLatticeAt(I->getValueOperand(), I->getParent()));
+}
+void SCCPSolver::visitMemIntrinsic(MemIntrinsic *I) {
+  auto S = SlotOf.find(I);
+  if (!S)
+    return;
+  auto AI = S->first;
+  uint64_t Len = cast<ConstantInt>(I->getLength())->getZExtValue();
+  for (auto &T : SlotTypes[AI]) {
+    uint64_t Off = T.first, Size = DL->getTypeStoreSize(T.second);
+    if (Off >= Len)
+      continue;
+    Constant *C = nullptr;
+    if (Off + Size <= Len) {
+      if (auto MT = dyn_cast<MemTransferInst>(I)) {
+        auto Src = cast<Constant>(MT->getSource());
+        C = ConstantFoldLoadFromConstPtr(Src, T.second, APInt(64, Off), *DL);
+      } else {
+        auto Byte = cast<ConstantInt>(I->getArgOperand(1));
+        if (Byte->isZero())
+          C = Constant::getNullValue(T.second);
+        else if (T.second->isIntegerTy())
+          C = ConstantInt::get(
+              T.second, APInt::getSplat(T.second->getIntegerBitWidth(),
+                                        Byte->getValue()));
+      }
+    }
+    meetSlot(Slot(AI, T.first), C ? LatticeElem(C) : LatticeElem(bottom));
+  }
+}
+void SCCPSolver::meetSlot(Slot S, const LatticeElem &LV) {
+  if (!MemCell[S].meet(LV))
+    return;
+  UNIT_TRACE(TraceDecision, dbgs() << "Slots: Changing offset " << S.second
+                                   << " of" << *S.first << " to "
+                                   << MemCell[S].info() << "\n");
+  for (auto LI : SlotLoads[S])
+    if (FlowMark[LI->getParent()])
+      pushSSA(LI);
+}
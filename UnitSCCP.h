@@ -1,8 +1,15 @@
 #ifndef INCLUDE_UNIT_SCCP_H
 #define INCLUDE_UNIT_SCCP_H
+#include "UnitLattice.h"
 #include "UnitLoopInfo.h"
+#include "UnitSparseSolver.h"
+#include "llvm/Analysis/OptimizationRemarkEmitter.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/IR/ConstantRange.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/PassManager.h"
+#include "llvm/Support/KnownBits.h"
 #include "llvm/Support/raw_ostream.h"
 #include <map>
 #include <queue>
@@ -20,74 +27,65 @@ using std::stringstream;
 using std::vector;
 
 namespace cs426 {
-/// Sparse Conditional Constant Propagation Optimization Pass
-
-enum LatticeStatus {
-  top, // may be constant
-  constant,
-  bottom // cannot be constant
+/// A fact about V learned from a branch condition. It holds on every path
+/// through the edge it was recorded on.
+struct PredicateFact {
+  Value *V;
+  ConstantRange Range;
 };
 
-struct LatticeElem {
-  LatticeStatus Status;
-  Constant *Val;
-  LatticeElem() : Status(top), Val(nullptr) {}
-  LatticeElem(Constant *Val) : Status(constant), Val(Val) { assert(Val); }
-  LatticeElem(LatticeStatus Status) : Status(Status), Val(nullptr) {}
-  bool isTop() const { return Status == top; }
-  bool isConstant() const { return Status == constant; }
-  bool isBottom() const { return Status == bottom; }
-  LatticeElem operator^(const LatticeElem &R) {
-    assert(Status != top || R.Status != top);
-    if (Status == bottom || R.Status == bottom)
-      return bottom;
-    if (Status == top)
-      return R;
-    if (R.Status == top)
-      return *this;
-    if (Val->isElementWiseEqual(R.Val))
-      return R;
-    return bottom;
-  }
-  bool markBottom() {
-    if (isBottom())
-      return false;
-    Status = bottom;
-    Val = nullptr;
-    return true;
-  }
-  bool meet(const LatticeElem &R) {
-    assert(Status != top || R.Status != top);
-    if (Status == bottom || R.Status == bottom)
-      return markBottom();
-
-    if (Status == top) {
-      *this = R;
-      return true;
-    }
-    if (R.Status == top)
-      return false;
+/// Sparse conditional constant propagation solver on the constant lattice.
+/// All per-function state lives here and is kept between solves: reset() is
+/// O(1) and the cells, queues and fact lists reuse their storage, so one
+/// solver can run many functions back to back with steady memory.
+class SCCPSolver : public SparseSolver<SCCPSolver, LatticeElem> {
+  friend class SparseSolver<SCCPSolver, LatticeElem>;
 
-    if (Val->isElementWiseEqual(R.Val))
-      return false;
-    return markBottom();
-  }
-  string getStatus(const LatticeStatus L);
-  string info();
-};
+public:
+  /// Solve \p F; lattice values stay queryable until the next solve
+  void solve(Function &F, DominatorTree &DT, TargetLibraryInfo &TLI);
+  /// Write constants back into \p F and return whether anything changed
+  bool rewrite(Function &F);
+  /// Report the values found constant and why the rest went bottom; call
+  /// between solve and rewrite
+  void emitRemarks(Function &F, OptimizationRemarkEmitter &ORE);
+  void reset();
+  static const char *debugType() { return "UnitSCCP"; }
 
-struct UnitSCCP : PassInfoMixin<UnitSCCP> {
-  // DataLayout *DL;
-  using Edge = pair<BasicBlock *, BasicBlock *>;
-  queue<BasicBlock *> FlowQ;
-  queue<Value *> SSAQ;
-  map<Edge, bool> ExecFlag;
-  map<BasicBlock *, bool> FlowMark;
-  map<Value *, LatticeElem> LatCell;
-  map<Value *, bool> InSSAQ;
-  PreservedAnalyses run(Function &F, FunctionAnalysisManager &FAM);
-  void init(Function &F);
+private:
+  // Bit-level lattice: a missing entry is top, KnownBits::commonBits is meet
+  EpochMap<Value *, KnownBits> BitCell;
+  // Nullness of pointer instructions, and for each pointer loaded or stored
+  // through, the first such access in every block that has one
+  EpochMap<Value *, Nullness> NullCell;
+  EpochMap<Value *, DomIndex<Instruction *>> Derefs;
+  DominatorTree *DT;
+  // Facts of conditional edges, and for each value the range the facts of
+  // such edges give it in the blocks they dominate, narrowed by the facts
+  // of the edges dominating those
+  EpochMap<Edge, vector<PredicateFact>> EdgeFacts;
+  EpochMap<Value *, DomIndex<ConstantRange>> ValueFacts;
+  const DataLayout *DL;
+  TargetLibraryInfo *TLI;
+  // Store-to-load lattice of non-escaping allocas, one cell per byte offset
+  using Slot = pair<AllocaInst *, int64_t>;
+  EpochMap<Instruction *, Slot> SlotOf; // tracked loads, stores, memintrinsics
+  EpochMap<Slot, LatticeElem> MemCell;
+  EpochMap<Slot, vector<LoadInst *>> SlotLoads;
+  EpochMap<AllocaInst *, map<int64_t, Type *>> SlotTypes;
+  void initialize(Function &F);
+  void collectFacts(Value *Cond, bool OnTrue, vector<PredicateFact> &Facts);
+  bool replacePredicatedUses();
+  void initSlots(AllocaInst *AI);
+  bool collectSlotAccesses(Value *Ptr, int64_t Offset,
+                           vector<pair<Instruction *, int64_t>> &Accesses);
+  void visitStore(StoreInst *I);
+  void visitMemIntrinsic(MemIntrinsic *I);
+  void meetSlot(Slot S, const LatticeElem &LV);
+  void visitTerminator(Instruction *I);
   void visitBranch(BranchInst *I);
+  void visitSwitch(SwitchInst *I);
+  void visitIndirectBr(IndirectBrInst *I);
   LatticeElem evalBinaryOp(BinaryOperator *I);
   LatticeElem evalUnaryOp(UnaryOperator *I);
   LatticeElem evalCast(CastInst *I);
@@ -95,23 +93,50 @@ struct UnitSCCP : PassInfoMixin<UnitSCCP> {
   LatticeElem evalSelect(SelectInst *I);
   LatticeElem evalGetElementPtr(GetElementPtrInst *I);
   LatticeElem evalPhi(PHINode *I);
+  LatticeElem evalLoad(LoadInst *I);
+  LatticeElem evalCall(CallInst *I);
+  LatticeElem evalExtractValue(ExtractValueInst *I);
+  LatticeElem evalInsertValue(InsertValueInst *I);
+  LatticeElem evalFreeze(FreezeInst *I);
+  LatticeElem insertField(const LatticeElem &Agg, Type *Ty,
+                          ArrayRef<unsigned> Idx, const LatticeElem &Val);
+  LatticeElem evalOverflow(WithOverflowInst *I);
+  LatticeElem evalExtractElement(ExtractElementInst *I);
+  LatticeElem evalInsertElement(InsertElementInst *I);
+  LatticeElem evalShuffleVector(ShuffleVectorInst *I);
+  LatticeElem evalLanewise(Instruction *I, const LatticeElem &Whole);
+  LatticeElem evalLane(Instruction *I, vector<LatticeElem> &L);
+  bool tracksBits(Instruction *I);
+  KnownBits getKnownBits(Value *V);
+  KnownBits evalBits(Instruction *I);
+  Optional<bool> evalCmpBits(ICmpInst *I);
+  bool updateBits(Instruction *I, KnownBits Known);
+  bool tracksNull(Instruction *I);
+  void collectDerefs(Function &F);
+  bool isDereferencedAt(Value *V, Instruction *At);
+  Nullness getNullness(Value *V);
+  Nullness getNullnessAt(Value *V, Instruction *At, BasicBlock *From = nullptr);
+  Nullness evalNull(Instruction *I);
+  Optional<bool> evalCmpNull(ICmpInst *I);
+  bool updateNull(Instruction *I, Nullness N);
   LatticeElem evalUnsupported(Instruction *I) { return bottom; }
+  LatticeElem folded(Constant *C);
   LatticeElem evalRet(ReturnInst *I) { return getLattice(I->getOperand(0)); }
   void visitInstruction(Instruction *I);
-  void visitBlock(BasicBlock *BB);
-  void addSSAOutEdges(Instruction *I);
-  LatticeElem getLattice(Value *V) {
-    if (auto C = dyn_cast<Constant>(V)) {
-      return LatticeElem(C);
-    }
-    assert(LatCell.count(V));
-    return LatCell[V];
-  }
-  string edgeInfo(Edge E) {
-    return "(" + getSimpleNodeLabel(E.first) + "," +
-           getSimpleNodeLabel(E.second) + ")";
+  ConstantRange getRangeAt(Value *V, BasicBlock *BB,
+                           BasicBlock *From = nullptr);
+  LatticeElem getLatticeAt(Value *V, BasicBlock *BB,
+                           BasicBlock *From = nullptr);
+  LatticeElem getValueOnEdge(Value *V, BasicBlock *From, BasicBlock *To) {
+    return getLatticeAt(V, To, From);
   }
 };
+
+/// Sparse Conditional Constant Propagation Optimization Pass
+struct UnitSCCP : PassInfoMixin<UnitSCCP> {
+  SCCPSolver Solver;
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &FAM);
+};
 } // namespace cs426
 
 #endif // INCLUDE_UNIT_SCCP_H
@@ -0,0 +1,145 @@
+#ifndef INCLUDE_UNIT_SOLVER_CONTEXT_H
+#define INCLUDE_UNIT_SOLVER_CONTEXT_H
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/Dominators.h"
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace cs426 {
+template <typename T> void resetCell(T &Cell) { Cell = T(); }
+template <typename T> void resetCell(std::vector<T> &Cell) { Cell.clear(); }
+template <typename K, typename T> void resetCell(std::map<K, T> &Cell) {
+  Cell.clear();
+}
+
+/// Map from IR objects to solver cells that is reused from one function to
+/// the next. Every entry is stamped with the epoch of the solve that wrote
+/// it, so reset() only bumps the epoch: stale entries read as absent and are
+/// recycled in place, keeping their buffers, when a later solve touches the
+/// same key. The map is only emptied once stale entries clearly outnumber
+/// the live ones, which bounds memory over a long run.
+template <typename KeyT, typename CellT> class EpochMap {
+  struct Entry {
+    unsigned Epoch = 0;
+    CellT Cell;
+  };
+  llvm::DenseMap<KeyT, Entry> Map;
+  std::vector<KeyT> Live; // keys of the current epoch, in insertion order
+  unsigned Epoch = 1;
+
+public:
+  CellT &operator[](const KeyT &K) {
+    auto &E = Map[K];
+    if (E.Epoch != Epoch) {
+      E.Epoch = Epoch;
+      resetCell(E.Cell);
+      Live.push_back(K);
+    }
+    return E.Cell;
+  }
+  /// Cell of \p K, or nullptr if the current solve has not written it
+  CellT *find(const KeyT &K) {
+    auto It = Map.find(K);
+    if (It == Map.end() || It->second.Epoch != Epoch)
+      return nullptr;
+    return &It->second.Cell;
+  }
+  bool count(const KeyT &K) const {
+    auto It = Map.find(K);
+    return It != Map.end() && It->second.Epoch == Epoch;
+  }
+  const std::vector<KeyT> &keys() const { return Live; }
+  void reset() {
+    if (Map.size() > 4 * Live.size() + 1024)
+      Map.clear();
+    Live.clear();
+    if (++Epoch == 0) { // wrapped: old stamps could look current again
+      Map.clear();
+      Epoch = 1;
+    }
+  }
+};
+
+/// Entries of one value at the blocks they hold in, kept in dominator tree
+/// order so the entry of the nearest block dominating a query block takes a
+/// binary search and a few steps up the entries, not a walk up the tree.
+/// The tree's DFS numbers must be up to date from add() on.
+template <typename T> class DomIndex {
+  struct Entry {
+    unsigned In, Out; // DFS numbers of the block's tree node
+    int Parent;       // nearest entry whose block dominates this one's
+    llvm::BasicBlock *BB;
+    T Val;
+  };
+  std::vector<Entry> Entries;
+
+public:
+  void add(const llvm::DomTreeNode *N, T Val) {
+    Entries.push_back({N->getDFSNumIn(), N->getDFSNumOut(), -1, N->getBlock(),
+                       std::move(Val)});
+  }
+  /// Order the entries and link each to its parent. \p Narrow(Dom, Val)
+  /// refines every value by its parent's, and the first entry of a block by
+  /// each later one of the same block, which it replaces.
+  template <typename FnT> void link(FnT Narrow) {
+    std::stable_sort(Entries.begin(), Entries.end(),
+                     [](const Entry &A, const Entry &B) { return A.In < B.In; });
+    std::vector<Entry> Linked;
+    std::vector<int> Open; // entries whose subtree the walk is in
+    for (auto &E : Entries) {
+      if (!Linked.empty() && Linked.back().In == E.In) {
+        Narrow(E.Val, Linked.back().Val);
+        continue;
+      }
+      while (!Open.empty() && Linked[Open.back()].Out < E.Out)
+        Open.pop_back();
+      E.Parent = Open.empty() ? -1 : Open.back();
+      if (E.Parent >= 0)
+        Narrow(Linked[E.Parent].Val, E.Val);
+      Open.push_back(Linked.size());
+      Linked.push_back(std::move(E));
+    }
+    Entries = std::move(Linked);
+  }
+  /// The entry of the nearest block dominating \p N's, itself included, or
+  /// -1 if there is none
+  int find(const llvm::DomTreeNode *N) const {
+    auto It = std::upper_bound(
+        Entries.begin(), Entries.end(), N->getDFSNumIn(),
+        [](unsigned In, const Entry &E) { return In < E.In; });
+    int i = int(It - Entries.begin()) - 1;
+    while (i >= 0 && Entries[i].Out < N->getDFSNumOut())
+      i = Entries[i].Parent;
+    return i;
+  }
+  int parent(int i) const { return Entries[i].Parent; }
+  llvm::BasicBlock *block(int i) const { return Entries[i].BB; }
+  const T &operator[](int i) const { return Entries[i].Val; }
+  size_t size() const { return Entries.size(); }
+};
+
+/// FIFO worklist over a vector that keeps its capacity once drained
+template <typename T> class WorkQueue {
+  std::vector<T> Items;
+  size_t Head = 0;
+
+public:
+  bool empty() const { return Head == Items.size(); }
+  void push(T V) { Items.push_back(V); }
+  T pop() {
+    T V = Items[Head++];
+    if (empty()) {
+      Items.clear();
+      Head = 0;
+    }
+    return V;
+  }
+  void reset() {
+    Items.clear();
+    Head = 0;
+  }
+};
+} // namespace cs426
+
+#endif // INCLUDE_UNIT_SOLVER_CONTEXT_H
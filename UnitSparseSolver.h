@@ -0,0 +1,212 @@
+#ifndef INCLUDE_UNIT_SPARSE_SOLVER_H
+#define INCLUDE_UNIT_SPARSE_SOLVER_H
+#include "UnitLoopInfo.h"
+#include "UnitSolverContext.h"
+#include "UnitTrace.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/raw_ostream.h"
+#include <string>
+#include <utility>
+
+// Engine trace points belong to the pass whose solver runs them
+#define DEBUG_TYPE SolverT::debugType()
+
+namespace cs426 {
+using namespace llvm;
+
+/// Conditional sparse dataflow engine in the style of Wegman and Zadeck:
+/// values only flow out of executable blocks and phis only listen to
+/// executable edges. It is shared by the unit analyses through CRTP, so
+/// every hook below is bound at compile time and a lattice pays for no
+/// virtual dispatch.
+///
+/// LatticeT starts out as top when default constructed, is constructible
+/// from a Constant *, and has `bool meet(const LatticeT &)` (true if the
+/// value changed), `bool isBottom()` and `bool markBottom()`.
+///
+/// SolverT derives from SparseSolver<SolverT, LatticeT>, names the
+/// DEBUG_TYPE of its traces with a static debugType(), and may shadow:
+///   reset()                     drop its own per-function state too
+///   initialize(F)               seed cells before the entry block runs
+///   visitInstruction(I)         whole visit of a non-terminator, e.g. with
+///                               side lattices; terminators go to the base
+///   transfer(I)                 value of a non-phi, non-terminator
+///   visitTerminator(I)          mark the feasible successor edges
+///   getValueOnEdge(V, From, To) value of V along an edge (refinement)
+template <typename SolverT, typename LatticeT> class SparseSolver {
+public:
+  using Edge = std::pair<BasicBlock *, BasicBlock *>;
+  /// Work done by the last run
+  struct Counters {
+    uint64_t BlockVisits = 0, BlockRevisits = 0, FlowPushes = 0,
+             SSAPushes = 0, SSAVisits = 0;
+  } Counts;
+
+  /// Run to a fixed point over \p F; cells stay readable until the next run
+  void run(Function &F) {
+    derived().reset();
+    derived().initialize(F);
+    FlowQ.push(&F.getEntryBlock());
+    while (!FlowQ.empty() || !SSAQ.empty()) {
+      while (!FlowQ.empty()) { // Executable
+        auto BB = FlowQ.pop();
+        UNIT_TRACE(TraceVisit, dbgs() << "\nFlowQ: Take Block from Flow queue:"
+                                      << getSimpleNodeLabel(BB) << "\n");
+        // Marked first: a store late in BB must be able to requeue an
+        // earlier load of BB
+        auto &Mark = FlowMark[BB];
+        Counts.BlockVisits++;
+        Counts.BlockRevisits += Mark;
+        Mark = true;
+        Visiting = BB;
+        for (auto &I : *BB)
+          derived().visitInstruction(&I);
+        Visiting = nullptr;
+      }
+      while (!SSAQ.empty()) { // Variable Changes
+        auto I = SSAQ.pop();
+        InSSAQ[I] = false;
+        Counts.SSAVisits++;
+        UNIT_TRACE(TraceVisit,
+                   dbgs() << "\nSSAQ: Take Instruction from SSA queue:" << *I
+                          << "\n");
+        derived().visitInstruction(I);
+      }
+    }
+  }
+  void reset() {
+    Counts = Counters();
+    FlowQ.reset();
+    SSAQ.reset();
+    ExecFlag.reset();
+    FlowMark.reset();
+    LatCell.reset();
+    InSSAQ.reset();
+  }
+  bool isExecutable(BasicBlock *BB) {
+    auto Mark = FlowMark.find(BB);
+    return Mark && *Mark;
+  }
+  bool isEdgeExecutable(BasicBlock *From, BasicBlock *To) {
+    auto Flag = ExecFlag.find(Edge(From, To));
+    return Flag && *Flag;
+  }
+  LatticeT getLattice(Value *V) {
+    if (auto C = dyn_cast<Constant>(V))
+      return LatticeT(C);
+    assert(LatCell.count(V));
+    return LatCell[V];
+  }
+
+protected:
+  WorkQueue<BasicBlock *> FlowQ;
+  WorkQueue<Instruction *> SSAQ;
+  EpochMap<Edge, bool> ExecFlag;
+  EpochMap<BasicBlock *, bool> FlowMark;
+  EpochMap<Value *, LatticeT> LatCell;
+  EpochMap<Value *, bool> InSSAQ;
+  BasicBlock *Visiting = nullptr; // block whose walk is in progress
+
+  SolverT &derived() { return static_cast<SolverT &>(*this); }
+
+  // Default hooks
+  void initialize(Function &F) {
+    for (auto &A : F.args())
+      LatCell[&A].markBottom();
+  }
+  void visitInstruction(Instruction *I) {
+    if (I->isTerminator()) {
+      derived().visitTerminator(I);
+      return;
+    }
+    if (LatCell[I].isBottom())
+      return;
+    auto New = isa<PHINode>(I) ? joinIncoming(cast<PHINode>(I))
+                               : derived().transfer(I);
+    if (LatCell[I].meet(New))
+      addSSAOutEdges(I);
+  }
+  LatticeT transfer(Instruction *I) {
+    LatticeT LV;
+    LV.markBottom();
+    return LV;
+  }
+  /// Every successor of a terminator the solver does not know better
+  /// about is feasible; invoke and callbr also define an unknown value
+  void visitTerminator(Instruction *I) {
+    for (auto SuccBB : successors(I->getParent()))
+      markEdgeExecutable(I->getParent(), SuccBB);
+    if (!I->getType()->isVoidTy() && LatCell[I].markBottom())
+      addSSAOutEdges(I);
+  }
+  LatticeT getValueOnEdge(Value *V, BasicBlock *From, BasicBlock *To) {
+    return derived().getLattice(V);
+  }
+
+  /// Meet of the incoming values of \p Phi over its executable edges
+  LatticeT joinIncoming(PHINode *Phi) {
+    LatticeT LV;
+    auto BB = Phi->getParent();
+    for (unsigned i = 0, n = Phi->getNumIncomingValues(); i < n; i++) {
+      auto PredBB = Phi->getIncomingBlock(i);
+      if (isEdgeExecutable(PredBB, BB))
+        LV.meet(
+            derived().getValueOnEdge(Phi->getIncomingValue(i), PredBB, BB));
+    }
+    return LV;
+  }
+  /// Queue \p To once per edge that becomes executable, so a block is
+  /// visited at most once per incoming edge
+  void markEdgeExecutable(BasicBlock *From, BasicBlock *To) {
+    auto &Flag = ExecFlag[Edge(From, To)];
+    if (Flag)
+      return;
+    Flag = true;
+    UNIT_TRACE(TraceDecision, dbgs() << "markEdge: Mark edge "
+                                     << edgeInfo(Edge(From, To))
+                                     << " executable\n");
+    Counts.FlowPushes++;
+    FlowQ.push(To);
+  }
+  void pushSSA(Instruction *I) {
+    auto &Queued = InSSAQ[I];
+    if (!Queued) {
+      Queued = true;
+      Counts.SSAPushes++;
+      SSAQ.push(I);
+    }
+  }
+  /// Revisit the users of \p I that sit in executable blocks
+  void addSSAOutEdges(Instruction *I) {
+    for (auto U : I->users()) {
+      if (auto J = dyn_cast<Instruction>(U)) {
+        // The walk over the current block reaches J by itself
+        if (J->getParent() == Visiting && I->getParent() == Visiting &&
+            I->comesBefore(J))
+          continue;
+        if (FlowMark[J->getParent()]) {
+          UNIT_TRACE(TraceVisit, dbgs() << "SSAOut: Push" << *J
+                                        << " in SSA Queue, due to" << *I
+                                        << "\n");
+          pushSSA(J);
+        } else {
+          UNIT_TRACE(TraceVisit,
+                     dbgs() << "SSAOut: Not push" << *J
+                            << " in SSA Queue, due to "
+                            << edgeInfo(Edge(I->getParent(), J->getParent()))
+                            << "'s sink not currently executable\n");
+        }
+      }
+    }
+  }
+  std::string edgeInfo(Edge E) {
+    return "(" + getSimpleNodeLabel(E.first) + "," +
+           getSimpleNodeLabel(E.second) + ")";
+  }
+};
+} // namespace cs426
+
+#undef DEBUG_TYPE
+
+#endif // INCLUDE_UNIT_SPARSE_SOLVER_H
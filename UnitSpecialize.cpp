@@ -0,0 +1,150 @@
+// Usage: opt -load-pass-plugin=libUnitProject.so -passes="unit-specialize"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include <algorithm>
+
+#include "UnitLoopInfo.h"
+#include "UnitSpecialize.h"
+#include "UnitTrace.h"
+
+#define DEBUG_TYPE "UnitSpecialize"
+// Define any statistics here
+
+using namespace llvm;
+using namespace cs426;
+
+STATISTIC(SClone, "Number of functions specialized");
+STATISTIC(SCall, "Number of call sites redirected to a specialization");
+
+static cl::opt<unsigned>
+    MaxSize("unit-spec-max-size", cl::init(300), cl::Hidden,
+            cl::desc("Largest callee, in instructions, to specialize"));
+static cl::opt<unsigned>
+    MinFreq("unit-spec-min-freq", cl::init(8), cl::Hidden,
+            cl::desc("Estimated calls a specialization must serve"));
+static cl::opt<unsigned>
+    Budget("unit-spec-budget", cl::init(2000), cl::Hidden,
+           cl::desc("Instructions the module may grow by in clones"));
+static cl::opt<unsigned>
+    MaxClones("unit-spec-max-clones", cl::init(3), cl::Hidden,
+              cl::desc("Most specializations of one function"));
+
+/// Each loop around a call counts as this many iterations
+static const uint64_t LoopWeight = 8;
+static const unsigned MaxDepth = 4;
+
+PreservedAnalyses UnitSpecialize::run(Module &M, ModuleAnalysisManager &MAM) {
+  UNIT_TRACE(TracePass,
+             dbgs() << "UnitSpecialize running on " << M.getName() << "\n");
+  auto &FAM = MAM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+  vector<Candidate> Cands;
+  collectCandidates(M, FAM, Cands);
+  // Most calls saved per instruction cloned first; ties keep module order
+  std::stable_sort(Cands.begin(), Cands.end(),
+                   [](const Candidate &A, const Candidate &B) {
+                     return A.Freq * B.Size > B.Freq * A.Size;
+                   });
+  unsigned Spent = 0;
+  map<Function *, unsigned> Clones;
+  for (auto &C : Cands) {
+    if (C.Freq < MinFreq || Spent + C.Size > Budget ||
+        Clones[C.Callee] >= MaxClones)
+      continue;
+    Spent += C.Size;
+    Clones[C.Callee]++;
+    auto Clone = specialize(C, FAM);
+    for (auto CB : C.Calls)
+      CB->setCalledFunction(Clone);
+    SClone++;
+    SCall += C.Calls.size();
+  }
+  UNIT_TRACE(TracePass,
+             dbgs() << "Specialize: cloned " << Spent << " instructions\n");
+  return Spent ? PreservedAnalyses::none() : PreservedAnalyses::all();
+}
+/// Group the direct calls in \p M by callee and constant arguments, with
+/// the loop depth of each call as its frequency estimate
+void UnitSpecialize::collectCandidates(Module &M, FunctionAnalysisManager &FAM,
+                                       vector<Candidate> &Cands) {
+  map<pair<Function *, ArgConsts>, size_t> Index;
+  for (auto &Caller : M) {
+    if (Caller.isDeclaration())
+      continue;
+    auto &Loops = FAM.getResult<UnitLoopAnalysis>(Caller);
+    for (auto &BB : Caller) {
+      for (auto &I : BB) {
+        auto CB = dyn_cast<CallBase>(&I);
+        auto Callee = CB ? CB->getCalledFunction() : nullptr;
+        if (!Callee || Callee == &Caller || Callee->isDeclaration() ||
+            Callee->isVarArg() || Callee->hasOptNone() ||
+            CB->getFunctionType() != Callee->getFunctionType() ||
+            (isa<CallInst>(CB) && cast<CallInst>(CB)->isMustTailCall()))
+          continue;
+        ArgConsts Args;
+        for (unsigned i = 0, n = CB->arg_size(); i < n; i++) {
+          // A byval argument is the callee's own copy of what the caller
+          // passes, and an sret one its result slot, not a plain pointer
+          if (CB->isPassPointeeByValueArgument(i) ||
+              CB->paramHasAttr(i, Attribute::StructRet))
+            continue;
+          auto C = dyn_cast<Constant>(CB->getArgOperand(i));
+          if (C && (isa<ConstantInt>(C) || isa<ConstantFP>(C) ||
+                    isa<ConstantPointerNull>(C) || isa<GlobalValue>(C)))
+            Args.push_back({i, C});
+        }
+        if (Args.empty())
+          continue;
+        unsigned Depth = 0;
+        for (auto L = Loops.getLoopFor(&BB); L && Depth < MaxDepth;
+             L = L->Parent)
+          Depth++;
+        auto Key = make_pair(Callee, Args);
+        auto It = Index.find(Key);
+        if (It == Index.end()) {
+          It = Index.insert({Key, Cands.size()}).first;
+          Cands.push_back({Callee, Args, {}, 0, 0});
+          Cands.back().Size = Callee->getInstructionCount();
+        }
+        auto &C = Cands[It->second];
+        C.Calls.push_back(CB);
+        uint64_t Freq = 1;
+        for (unsigned d = 0; d < Depth; d++)
+          Freq *= LoopWeight;
+        C.Freq += Freq;
+      }
+    }
+  }
+  Cands.erase(std::remove_if(Cands.begin(), Cands.end(),
+                             [](const Candidate &C) {
+                               return C.Size > MaxSize;
+                             }),
+              Cands.end());
+}
+/// Clone the callee of \p C with its constant arguments substituted and
+/// fold what they decide
+Function *UnitSpecialize::specialize(Candidate &C,
+                                     FunctionAnalysisManager &FAM) {
+  ValueToValueMapTy VMap;
+  auto Clone = CloneFunction(C.Callee, VMap);
+  Clone->setName(C.Callee->getName() + ".spec");
+  Clone->setLinkage(GlobalValue::InternalLinkage);
+  Clone->setVisibility(GlobalValue::DefaultVisibility);
+  for (auto &AC : C.Args)
+    Clone->getArg(AC.first)->replaceAllUsesWith(AC.second);
+  UNIT_TRACE(TracePass, dbgs() << "Specialize: " << C.Callee->getName()
+                               << " as " << Clone->getName() << " for "
+                               << C.Calls.size() << " calls\n");
+  Solver.solve(*Clone, FAM.getResult<DominatorTreeAnalysis>(*Clone),
+               FAM.getResult<TargetLibraryAnalysis>(*Clone));
+  Solver.rewrite(*Clone);
+  // Drop the paths the constants ruled out, so the clone is smaller
+  for (auto &BB : *Clone)
+    ConstantFoldTerminator(&BB, true);
+  removeUnreachableBlocks(*Clone);
+  FAM.invalidate(*Clone, PreservedAnalyses::none());
+  return Clone;
+}
@@ -0,0 +1,33 @@
+#ifndef INCLUDE_UNIT_SPECIALIZE_H
+#define INCLUDE_UNIT_SPECIALIZE_H
+#include "UnitSCCP.h"
+#include "llvm/IR/PassManager.h"
+
+using namespace llvm;
+
+namespace cs426 {
+/// Function specialization on constant arguments. Direct calls that pass
+/// the same constants to a function are grouped; a group whose estimated
+/// call frequency is high enough gets its own clone of the callee with
+/// those arguments replaced by the constants, simplified by the SCCP
+/// solver, and its calls redirected to the clone. Small callees and call
+/// sites deep in loops go first, until the module growth budget is spent.
+struct UnitSpecialize : PassInfoMixin<UnitSpecialize> {
+  /// Constant arguments by position, the key of a specialization
+  using ArgConsts = vector<pair<unsigned, Constant *>>;
+  struct Candidate {
+    Function *Callee;
+    ArgConsts Args;
+    vector<CallBase *> Calls;
+    uint64_t Freq = 0; // estimated calls per run of the callers
+    unsigned Size = 0; // instructions of the callee
+  };
+  SCCPSolver Solver;
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &MAM);
+  void collectCandidates(Module &M, FunctionAnalysisManager &FAM,
+                         vector<Candidate> &Cands);
+  Function *specialize(Candidate &C, FunctionAnalysisManager &FAM);
+};
+} // namespace cs426
+
+#endif // INCLUDE_UNIT_SPECIALIZE_H
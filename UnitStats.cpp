@@ -0,0 +1,65 @@
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/raw_ostream.h"
+#include <mutex>
+#include <sys/resource.h>
+
+#include "UnitStats.h"
+
+using namespace llvm;
+using namespace cs426;
+
+static cl::opt<std::string>
+    StatsFile("unit-stats-json", cl::init(""), cl::Hidden,
+              cl::desc("Append per-function timing and counters of the unit "
+                       "passes as JSON lines to this file ('-' for stderr)"));
+
+StatsRecord::StatsRecord(StringRef Pass, Function &F)
+    : Enabled(!StatsFile.empty()) {
+  if (!Enabled)
+    return;
+  this->Pass = Pass.str();
+  FuncName = F.getName().str();
+  Start = Clock::now();
+}
+StatsRecord::~StatsRecord() {
+  if (!Enabled)
+    return;
+  double Wall = seconds(Start);
+  struct rusage Usage;
+  getrusage(RUSAGE_SELF, &Usage);
+
+  // unit-opt -j finishes records on several threads at once
+  static std::mutex Lock;
+  std::lock_guard<std::mutex> Guard(Lock);
+  raw_ostream *OS = &errs();
+  std::unique_ptr<raw_fd_ostream> File;
+  if (StatsFile != "-") {
+    std::error_code EC;
+    File = std::make_unique<raw_fd_ostream>(
+        StatsFile, EC, sys::fs::OF_Append | sys::fs::OF_Text);
+    if (EC) {
+      errs() << "unit-stats-json: " << EC.message() << "\n";
+      return;
+    }
+    OS = File.get();
+  }
+  json::OStream J(*OS);
+  J.object([&] {
+    J.attribute("pass", Pass);
+    J.attribute("function", FuncName);
+    J.attribute("wall_s", Wall);
+    J.attributeObject("phases_s", [&] {
+      for (auto &P : Phases)
+        J.attribute(P.first, P.second);
+    });
+    J.attributeObject("counters", [&] {
+      for (auto &C : Counters)
+        J.attribute(C.first, static_cast<int64_t>(C.second));
+    });
+    // ru_maxrss is in kilobytes on Linux
+    J.attribute("peak_rss_kb", static_cast<int64_t>(Usage.ru_maxrss));
+  });
+  *OS << "\n";
+}
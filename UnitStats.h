@@ -0,0 +1,65 @@
+#ifndef INCLUDE_UNIT_STATS_H
+#define INCLUDE_UNIT_STATS_H
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/Function.h"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+
+using namespace llvm;
+
+namespace cs426 {
+/// Instrumentation of one run of a unit pass on one function. With
+/// -unit-stats-json=<file> the record is appended to <file> ("-" for
+/// stderr) as one line of JSON when it goes out of scope: wall time of the
+/// run and of each named phase, event counters, and the peak resident
+/// memory of the process so far. Without the option a record only ever
+/// tests a flag. opt only parses the option with the plugin also given to
+/// -load; unit-opt always does.
+class StatsRecord {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /// Adds the time until it goes out of scope to a phase; phases may repeat
+  /// and nest
+  class Phase {
+  public:
+    Phase(StatsRecord &R, StringRef Name) : R(R), Name(Name) {
+      if (R.Enabled)
+        Start = Clock::now();
+    }
+    ~Phase() {
+      if (R.Enabled)
+        R.Phases[Name.str()] += seconds(Start);
+    }
+
+  private:
+    StatsRecord &R;
+    StringRef Name;
+    Clock::time_point Start;
+  };
+
+  StatsRecord(StringRef Pass, Function &F);
+  ~StatsRecord();
+  bool enabled() const { return Enabled; }
+  void count(StringRef Counter, uint64_t N = 1) {
+    if (Enabled)
+      Counters[Counter.str()] += N;
+  }
+
+private:
+  bool Enabled;
+  std::string Pass, FuncName;
+  Clock::time_point Start;
+  std::map<std::string, double> Phases;
+  std::map<std::string, uint64_t> Counters;
+
+  static double seconds(Clock::time_point Since) {
+    return std::chrono::duration<double>(Clock::now() - Since).count();
+  }
+};
+} // namespace cs426
+
+#endif // INCLUDE_UNIT_STATS_H
@@ -0,0 +1,25 @@
+#include "llvm/Support/CommandLine.h"
+
+#include "UnitTrace.h"
+
+using namespace llvm;
+
+bool cs426::TraceOn = false;
+
+static cl::list<std::string> TraceTypes(
+    "unit-trace", cl::CommaSeparated, cl::Hidden,
+    cl::desc("Trace the unit passes of these DEBUG_TYPEs, or all"),
+    cl::callback([](const std::string &) { cs426::TraceOn = true; }));
+static cl::opt<unsigned>
+    MaxTraceLevel("unit-trace-level", cl::init(cs426::TracePass), cl::Hidden,
+                  cl::desc("Most detailed trace level shown: "
+                           "1 transformations, 2 decisions, 3 visits"));
+
+bool cs426::isTraced(const char *Type, unsigned Level) {
+  if (Level > MaxTraceLevel)
+    return false;
+  for (auto &T : TraceTypes)
+    if (T == "all" || T == Type)
+      return true;
+  return false;
+}
@@ -0,0 +1,38 @@
+#ifndef INCLUDE_UNIT_TRACE_H
+#define INCLUDE_UNIT_TRACE_H
+#include "llvm/Support/Debug.h"
+
+namespace cs426 {
+/// Tracing of the unit passes, in place of LLVM_DEBUG whose -debug options
+/// a release LLVM leaves out. A trace point belongs to the DEBUG_TYPE of its
+/// file and has a level:
+///   -unit-trace=<type,...|all>  the categories to trace
+///   -unit-trace-level=<n>       the most detailed level shown (default 1)
+/// opt only parses these with the plugin also given to -load. Under NDEBUG
+/// trace points compile to nothing; otherwise a disabled one tests a single
+/// flag and formats nothing.
+enum TraceLevel {
+  TracePass = 1,     ///< Pass runs and transformations made
+  TraceDecision = 2, ///< Why something was or was not transformed
+  TraceVisit = 3,    ///< Every visited instruction, block and query
+};
+
+/// Set when any category is traced
+extern bool TraceOn;
+bool isTraced(const char *Type, unsigned Level);
+} // namespace cs426
+
+#ifndef NDEBUG
+#define UNIT_TRACE(LEVEL, X)                                                   \
+  do {                                                                         \
+    if (::cs426::TraceOn && ::cs426::isTraced(DEBUG_TYPE, LEVEL)) {            \
+      X;                                                                       \
+    }                                                                          \
+  } while (false)
+#else
+#define UNIT_TRACE(LEVEL, X)                                                   \
+  do {                                                                         \
+  } while (false)
+#endif
+
+#endif // INCLUDE_UNIT_TRACE_H
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+"""Emit a synthetic LLVM IR module for benchmarking the unit passes.
+
+Usage: bench/gen_ir.py <shape> <size> [--funcs N] [--seed S]
+
+Shapes:
+  phis   one loop with <size> independent induction chains, each starting
+         at and stepping by distinct 64-bit constants
+  diamonds  a chain of <size> if-then-else diamonds over one value; it is
+         constant in even functions, so half of the branches fold
+  nest   <size> perfectly nested loops with invariant arithmetic and a store
+         in the innermost body
+  wide   one loop whose body is <size> blocks, each with an invariant
+         computation and an early exit to the latch
+  memops one loop with <size> loads and <size> stores through two pointers
+         that may alias
+  cfg    a loop-free CFG of <size> blocks, each branching to two random
+         later blocks; the condition is constant in even functions
+"""
+import argparse
+import random
+
+
+def gen_phis(out, name, size, rnd):
+    out.append("define i64 @%s(i64 %%n) {" % name)
+    out.append("entry:\n  br label %loop\nloop:")
+    out.append("  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]")
+    for k in range(size):
+        out.append("  %%p%d = phi i64 [ %d, %%entry ], [ %%n%d, %%loop ]"
+                   % (k, rnd.getrandbits(62), k))
+    for k in range(size):
+        out.append("  %%n%d = add i64 %%p%d, %d" % (k, k, rnd.getrandbits(62)))
+    out.append("  %i.next = add i64 %i, 1")
+    out.append("  %c = icmp slt i64 %i.next, %n")
+    out.append("  br i1 %c, label %loop, label %exit\nexit:")
+    acc = "0"
+    for k in range(size):
+        out.append("  %%s%d = xor i64 %s, %%n%d" % (k, acc, k))
+        acc = "%%s%d" % k
+    out.append("  ret i64 %s\n}" % acc)
+
+
+def gen_diamonds(out, name, size, rnd):
+    out.append("define i64 @%s(i64 %%a) {\nentry:" % name)
+    if int(name[1:]) % 2 == 0:
+        out.append("  %%v0 = add i64 0, %d" % rnd.getrandbits(62))
+    else:
+        out.append("  %v0 = add i64 %a, 0")
+    out.append("  br label %b0")
+    for k in range(size):
+        out.append("b%d:" % k)
+        out.append("  %%c%d = icmp ult i64 %%v%d, %d"
+                   % (k, k, rnd.getrandbits(63)))
+        out.append("  br i1 %%c%d, label %%t%d, label %%e%d" % (k, k, k))
+        out.append("t%d:\n  %%vt%d = add i64 %%v%d, %d\n  br label %%j%d"
+                   % (k, k, k, rnd.getrandbits(62), k))
+        out.append("e%d:\n  %%ve%d = mul i64 %%v%d, %d\n  br label %%j%d"
+                   % (k, k, k, rnd.getrandbits(62), k))
+        out.append("j%d:" % k)
+        out.append("  %%v%d = phi i64 [ %%vt%d, %%t%d ], [ %%ve%d, %%e%d ]"
+                   % (k + 1, k, k, k, k))
+        out.append("  br label %%b%d" % (k + 1))
+    out.append("b%d:\n  ret i64 %%v%d\n}" % (size, size))
+
+
+def gen_nest(out, name, size, rnd):
+    out.append("define void @%s(i64 %%n, i64* %%p) {" % name)
+    out.append("entry:\n  br label %h0")
+    for k in range(size):
+        pred = "entry" if k == 0 else "h%d" % (k - 1)
+        out.append("h%d:" % k)
+        out.append("  %%i%d = phi i64 [ 0, %%%s ], [ %%i%d.next, %%l%d ]"
+                   % (k, pred, k, k))
+        if k + 1 < size:
+            out.append("  br label %%h%d" % (k + 1))
+    out.append("  %%inv = mul i64 %%n, %d" % rnd.getrandbits(62))
+    out.append("  %%x = add i64 %%inv, %%i%d" % (size - 1))
+    out.append("  %%a = getelementptr i64, i64* %%p, i64 %%i%d" % (size - 1))
+    out.append("  store i64 %x, i64* %a")
+    out.append("  br label %%l%d" % (size - 1))
+    for k in reversed(range(size)):
+        out.append("l%d:" % k)
+        out.append("  %%i%d.next = add i64 %%i%d, 1" % (k, k))
+        out.append("  %%c%d = icmp slt i64 %%i%d.next, %%n" % (k, k))
+        out.append("  br i1 %%c%d, label %%h%d, label %%%s"
+                   % (k, k, "exit" if k == 0 else "l%d" % (k - 1)))
+    out.append("exit:\n  ret void\n}")
+
+
+def gen_wide(out, name, size, rnd):
+    out.append("define void @%s(i64 %%n, i64* %%p) {" % name)
+    out.append("entry:\n  br label %loop\nloop:")
+    out.append("  %i = phi i64 [ 0, %entry ], [ %i.next, %latch ]")
+    out.append("  br label %b0")
+    for k in range(size):
+        out.append("b%d:" % k)
+        out.append("  %%x%d = mul i64 %%n, %d" % (k, rnd.getrandbits(62)))
+        out.append("  %%a%d = getelementptr i64, i64* %%p, i64 %d" % (k, k))
+        out.append("  store i64 %%x%d, i64* %%a%d" % (k, k))
+        out.append("  %%c%d = icmp eq i64 %%i, %d" % (k, k))
+        out.append("  br i1 %%c%d, label %%latch, label %%%s"
+                   % (k, "b%d" % (k + 1) if k + 1 < size else "latch"))
+    out.append("latch:\n  %i.next = add i64 %i, 1")
+    out.append("  %c = icmp slt i64 %i.next, %n")
+    out.append("  br i1 %c, label %loop, label %exit\nexit:\n  ret void\n}")
+
+
+def gen_memops(out, name, size, rnd):
+    out.append("define void @%s(i64 %%n, i64* %%p, i64* %%q) {" % name)
+    out.append("entry:\n  br label %loop\nloop:")
+    out.append("  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]")
+    for k in range(size):
+        src, dst = ("p", "q") if k % 2 == 0 else ("q", "p")
+        out.append("  %%g%d = getelementptr i64, i64* %%%s, i64 %d"
+                   % (k, src, rnd.randrange(size)))
+        out.append("  %%v%d = load i64, i64* %%g%d" % (k, k))
+        out.append("  %%w%d = add i64 %%v%d, %%i" % (k, k))
+        out.append("  %%s%d = getelementptr i64, i64* %%%s, i64 %d"
+                   % (k, dst, rnd.randrange(size)))
+        out.append("  store i64 %%w%d, i64* %%s%d" % (k, k))
+    out.append("  %i.next = add i64 %i, 1")
+    out.append("  %c = icmp slt i64 %i.next, %n")
+    out.append("  br i1 %c, label %loop, label %exit\nexit:\n  ret void\n}")
+
+
+def gen_cfg(out, name, size, rnd):
+    out.append("define void @%s(i64 %%a, i64* %%p) {\nentry:" % name)
+    if int(name[1:]) % 2 == 0:
+        out.append("  %%v = add i64 0, %d" % rnd.getrandbits(62))
+    else:
+        out.append("  %v = add i64 %a, 0")
+    out.append("  br label %b0")
+    for k in range(size):
+        out.append("b%d:" % k)
+        out.append("  %%x%d = xor i64 %%v, %d" % (k, rnd.getrandbits(62)))
+        out.append("  %%g%d = getelementptr i64, i64* %%p, i64 %d" % (k, k))
+        out.append("  store i64 %%x%d, i64* %%g%d" % (k, k))
+        out.append("  %%c%d = icmp ult i64 %%x%d, %d"
+                   % (k, k, rnd.getrandbits(63)))
+        t, f = [rnd.randint(k + 1, min(k + 8, size)) for _ in range(2)]
+        out.append("  br i1 %%c%d, label %%b%d, label %%b%d" % (k, t, f))
+    out.append("b%d:\n  ret void\n}" % size)
+
+
+SHAPES = {"phis": gen_phis, "diamonds": gen_diamonds, "nest": gen_nest,
+          "wide": gen_wide, "memops": gen_memops, "cfg": gen_cfg}
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawTextHelpFormatter)
+    ap.add_argument("shape", choices=sorted(SHAPES))
+    ap.add_argument("size", type=int)
+    ap.add_argument("--funcs", type=int, default=1)
+    ap.add_argument("--seed", type=int, default=426)
+    args = ap.parse_args()
+    rnd = random.Random(args.seed)
+    out = []
+    for f in range(args.funcs):
+        SHAPES[args.shape](out, "f%d" % f, args.size, rnd)
+        out.append("")
+    print("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,77 @@
+#!/bin/bash
+# Compare output IR size and llc time of the test_c pipeline between two
+# builds of the plugin, on official_tests or the given .c/.ll inputs.
+# Usage: bench/irsize.sh <old libUnitProject.so> <new libUnitProject.so>
+#                        [runs] [inputs...]
+# Inputs that do not compile or optimize are reported on stderr and left
+# out. When both builds write the same IR, llc times the same input twice,
+# so the row says "same" instead of a time delta.
+# Set LLVM to the LLVM build directory if the tools are not on PATH.
+
+old=$1
+new=$2
+runs=${3:-5}
+if [ -z "$old" ] || [ -z "$new" ]; then
+  echo "usage: $0 <old libUnitProject.so> <new libUnitProject.so> [runs]" \
+    "[inputs...]" >&2
+  exit 1
+fi
+shift $(($# < 3 ? $# : 3))
+
+bin=${LLVM:+$LLVM/bin/}
+root=$(cd "$(dirname "$0")/.." && pwd)
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+# OPTFLAGS of test_c/Makefile
+passes=$(cd "$root/bench" && python3 -c 'import pipelines
+print(pipelines.OPTFLAGS)') || exit 1
+
+# Best wall time of $runs runs of llc, in milliseconds
+llc_time() {
+  local best=
+  for ((i = 0; i < runs; i++)); do
+    local s=$(date +%s%N)
+    "${bin}llc" -O2 "$1" -o /dev/null
+    local t=$((($(date +%s%N) - s) / 1000000))
+    if [ -z "$best" ] || [ "$t" -lt "$best" ]; then best=$t; fi
+  done
+  echo "$best"
+}
+
+printf "%-16s %10s %10s %7s %9s %9s %7s\n" test old-bytes new-bytes size \
+  old-llc new-llc llc
+[ $# -gt 0 ] || set -- "$root"/official_tests/*.c
+for src in "$@"; do
+  name=$(basename "${src%.*}")
+  case $src in
+  *.ll) cp "$src" "$work/$name.ll" ;;
+  *) if ! "${bin}clang" -emit-llvm -S "$src" -o "$work/$name.ll" \
+    -Xclang -disable-O0-optnone 2>/dev/null; then
+    echo "$name: clang failed, skipped" >&2
+    continue
+  fi ;;
+  esac
+  for v in old new; do
+    lib=$old
+    [ $v = new ] && lib=$new
+    if ! "${bin}opt" -S -load-pass-plugin="$lib" -passes="$passes" \
+      "$work/$name.ll" -o "$work/$name.$v.ll" 2>/dev/null; then
+      echo "$name: opt failed with the $v plugin, skipped" >&2
+      continue 2
+    fi
+  done
+  ob=$(wc -c <"$work/$name.old.ll")
+  nb=$(wc -c <"$work/$name.new.ll")
+  if cmp -s "$work/$name.old.ll" "$work/$name.new.ll"; then
+    printf "%-16s %10d %10d %7s %9s %9s %7s\n" "$name" "$ob" "$nb" same - - \
+      same
+    continue
+  fi
+  ot=$(llc_time "$work/$name.old.ll")
+  nt=$(llc_time "$work/$name.new.ll")
+  awk -v n="$name" -v ob="$ob" -v nb="$nb" -v ot="$ot" -v nt="$nt" 'BEGIN {
+    printf "%-16s %10d %10d %6.1f%% %7dms %7dms %6.1f%%\n", n, ob, nb,
+      (nb - ob) * 100 / ob, ot, nt, ot ? (nt - ot) * 100 / ot : 0
+  }'
+done
@@ -0,0 +1,27 @@
+"""The pipelines of test_c/Makefile, read from it for the benchmarks.
+
+  OPTFLAGS   the test_c pipeline, with unit-sccp and unit-licm
+  OPT0FLAGS  its cleanup passes alone
+  STOCK      OPTFLAGS with LLVM's own sccp and licm in place of ours
+"""
+import os
+import re
+
+MAKEFILE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..",
+                        "test_c", "Makefile")
+
+
+def passes(var):
+    """The -passes string of the assignment to var in test_c/Makefile"""
+    with open(MAKEFILE) as f:
+        for line in f:
+            m = re.match(r'%s\s*=.*-passes="([^"]*)"' % var, line)
+            if m:
+                return m.group(1)
+    raise KeyError("%s has no -passes in %s" % (var, MAKEFILE))
+
+
+OPTFLAGS = passes("OPTFLAGS")
+OPT0FLAGS = passes("OPT0FLAGS")
+STOCK = re.sub(r"\bunit-licm\b", "loop-mssa(licm)",
+               re.sub(r"\bunit-sccp\b", "sccp", OPTFLAGS))
@@ -0,0 +1,287 @@
+#!/usr/bin/env python3
+"""Differential report of the unit passes against LLVM's licm, sccp, ipsccp.
+
+Usage: bench/refdiff.py <libUnitProject.so> [inputs...] [--modes M...]
+                       [--base PASSES] [-v]
+
+Every input (.c through clang, .cl through the reference COOL compiler, or
+.ll as is; default official_tests/*.c and test/*.cl) is put through the
+--base passes (default mem2reg, so instcombine leaves something to find)
+and instnamer, so every instruction has a name that survives both
+pipelines. Each mode then runs our pass and its LLVM counterpart on that
+module separately:
+
+  licm    unit-licm against loop-mssa(licm): instructions moved out of
+          their innermost loop, reported per function and per loop
+  sccp    unit-sccp against sccp: instructions folded away, per function
+  ipsccp  unit-global-sccp,unit-dead-args,function(unit-sccp) against
+          ipsccp: instructions folded away, per function
+
+and compares the instruction sets: what only the reference did, what only
+ours did, and what both did. -v lists the instructions per function and
+loop; the summary table at the end has one row per input. Set LLVM to pick
+the tools and CC to pick the C compiler (default clang).
+"""
+import argparse
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.join(HERE, "..")
+COOL = os.path.join(ROOT, "reference-binaries")
+
+MODES = {
+    "licm": ("unit-licm", "loop-mssa(licm)"),
+    "sccp": ("unit-sccp", "sccp"),
+    "ipsccp": ("unit-global-sccp,unit-dead-args,function(unit-sccp)",
+               "ipsccp"),
+}
+
+NAME = r'("[^"]+"|[-\w.$]+)'
+DEFINE = re.compile(r"^define .*@" + NAME + r"\(")
+LABEL = re.compile(r"^" + NAME + ":")
+DEF = re.compile(r"^\s+%" + NAME + " = ")
+SUCC = re.compile(r"label %" + NAME)
+# Ours leaves a folded condition in place for simplifycfg to clean up
+CONST_BR = re.compile(r"^\s+br i1 (true|false), label %" + NAME
+                      + ", label %" + NAME)
+
+
+def tool(name):
+    if "LLVM" in os.environ:
+        return os.path.join(os.environ["LLVM"], "bin", name)
+    return name
+
+
+class Function:
+    """Blocks in order, their successors, and the block of each value"""
+
+    def __init__(self):
+        self.order, self.succs, self.block = [], {}, {}
+
+    def reachable(self):
+        reach, stack = set(), self.order[:1]
+        while stack:
+            b = stack.pop()
+            if b not in reach:
+                reach.add(b)
+                stack.extend(self.succs.get(b, []))
+        return reach
+
+    def loops(self):
+        """Natural loops as {header: set of blocks}"""
+        preds = {b: [] for b in self.order}
+        for b in self.order:
+            for s in self.succs[b]:
+                preds.setdefault(s, []).append(b)
+        reach = self.reachable()
+        entry = self.order[0]
+        dom = {b: set(reach) for b in reach}
+        dom[entry] = {entry}
+        changed = True
+        while changed:
+            changed = False
+            for b in self.order:
+                if b == entry or b not in reach:
+                    continue
+                new = set.intersection(*[dom[p] for p in preds[b]
+                                         if p in reach]) | {b}
+                if new != dom[b]:
+                    dom[b], changed = new, True
+        loops = {}
+        for t in reach:
+            for h in self.succs[t]:
+                if h not in dom[t]:
+                    continue
+                body, stack = loops.setdefault(h, {h}), [t]
+                while stack:
+                    b = stack.pop()
+                    if b not in body:
+                        body.add(b)
+                        stack.extend(p for p in preds[b] if p in reach)
+        return loops
+
+
+def parse(path):
+    """{function name: Function} of the definitions in an .ll file"""
+    funcs, f, bb = {}, None, None
+    for line in open(path):
+        m = DEFINE.match(line)
+        if m:
+            name, f, bb = m.group(1), Function(), None
+            continue
+        if f is None:
+            continue
+        if line.startswith("}"):
+            funcs[name], f = f, None
+            continue
+        m = LABEL.match(line)
+        if m:
+            bb = m.group(1)
+        elif not line.strip() or line.lstrip().startswith(";"):
+            continue
+        elif bb is None:
+            bb = "<entry>"
+        if bb not in f.succs:
+            f.order.append(bb)
+            f.succs[bb] = []
+        if m:
+            continue
+        m = DEF.match(line)
+        if m:
+            f.block[m.group(1)] = bb
+        m = CONST_BR.match(line)
+        if m:
+            f.succs[bb].append(m.group(2) if m.group(1) == "true"
+                               else m.group(3))
+        else:
+            f.succs[bb] += SUCC.findall(line)
+    return funcs
+
+
+def hoisted(base, out):
+    """{(function, loop header): values moved out of their innermost loop}"""
+    res = {}
+    for fn, f in base.items():
+        g = out.get(fn)
+        if not g:
+            continue
+        loops = f.loops()
+        for v, b in f.block.items():
+            inner = [(len(body), h) for h, body in loops.items() if b in body]
+            if not inner:
+                continue
+            h = min(inner)[1]
+            # licm sinks by cloning into the exits as <name>.le
+            nb = g.block.get(v, g.block.get(v + ".le"))
+            if nb is not None and nb not in loops[h]:
+                res.setdefault((fn, h), set()).add(v)
+    return res
+
+
+def folded(base, out):
+    """{(function, ""): values that are gone}"""
+    res = {}
+    for fn, f in base.items():
+        g = out.get(fn)
+        if g:
+            # sccp deletes the blocks it proved dead, ours only folds the
+            # branches to them
+            live = g.reachable()
+            gone = {v for v in f.block if g.block.get(v) not in live}
+            if gone:
+                res[(fn, "")] = gone
+    return res
+
+
+def to_ll(src, base, work):
+    """IR of src after the base passes, every value named"""
+    stem = os.path.join(work, os.path.basename(src))
+    if src.endswith(".c"):
+        subprocess.run([os.environ.get("CC", tool("clang")), "-emit-llvm",
+                        "-S", src, "-o", stem + ".in.ll", "-Xclang",
+                        "-disable-O0-optnone"], check=True)
+    elif src.endswith(".cl"):
+        with open(stem + ".in.ll", "w") as ll:
+            front = subprocess.Popen(
+                "%s/lexer %s | %s/parser | %s/semant | %s/cgen-2 -c "
+                "2>/dev/null" % (COOL, src, COOL, COOL, COOL), shell=True,
+                stdout=ll)
+            if front.wait():
+                raise subprocess.CalledProcessError(front.returncode, "cgen")
+    else:
+        shutil.copy(src, stem + ".in.ll")
+    return run_opt(None, base + ",function(instnamer)", stem + ".in.ll",
+                   stem + ".base.ll")
+
+
+def run_opt(lib, passes, ll, out):
+    cmd = [tool("opt"), "-S", "-passes=" + passes, ll, "-o", out]
+    if lib:
+        cmd.insert(1, "-load-pass-plugin=" + lib)
+    with open(os.devnull, "w") as null:
+        subprocess.run(cmd, check=True, stderr=null)
+    return out
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("plugin")
+    ap.add_argument("inputs", nargs="*")
+    ap.add_argument("--modes", nargs="+", choices=list(MODES),
+                    default=list(MODES))
+    ap.add_argument("--base", default="function(mem2reg)",
+                    help="e.g. OPT0FLAGS of test_c/Makefile")
+    ap.add_argument("-v", "--verbose", action="store_true")
+    args = ap.parse_args()
+    lib = os.path.abspath(args.plugin)
+    inputs = args.inputs or sorted(
+        [os.path.join(ROOT, "official_tests", f)
+         for f in os.listdir(os.path.join(ROOT, "official_tests"))
+         if f.endswith(".c")]
+        + [os.path.join(ROOT, "test", f)
+           for f in os.listdir(os.path.join(ROOT, "test"))
+           if f.endswith(".cl")])
+    rows = []
+    with tempfile.TemporaryDirectory() as work:
+        for src in inputs:
+            name = os.path.splitext(os.path.basename(src))[0]
+            try:
+                base_ll = to_ll(src, args.base, work)
+            except subprocess.CalledProcessError as e:
+                print("%s: front end failed: %s" % (name, e.cmd),
+                      file=sys.stderr)
+                continue
+            base = parse(base_ll)
+            row = {}
+            for mode in args.modes:
+                ours_p, ref_p = MODES[mode]
+                diff = hoisted if mode == "licm" else folded
+                try:
+                    ours = diff(base, parse(run_opt(
+                        lib, ours_p, base_ll, base_ll + ".ours.ll")))
+                    ref = diff(base, parse(run_opt(
+                        None, ref_p, base_ll, base_ll + ".ref.ll")))
+                except subprocess.CalledProcessError:
+                    print("%s: %s failed" % (name, mode), file=sys.stderr)
+                    continue
+                counts = [0, 0, 0]
+                for key in sorted(set(ours) | set(ref)):
+                    o, r = ours.get(key, set()), ref.get(key, set())
+                    counts[0] += len(r - o)
+                    counts[1] += len(o - r)
+                    counts[2] += len(o & r)
+                    if args.verbose and o != r:
+                        fn, loop = key
+                        print("%s %s %s%s" % (name, mode, fn,
+                                              " loop " + loop if loop else ""))
+                        if r - o:
+                            print("  ref only:  " + " ".join(sorted(r - o)))
+                        if o - r:
+                            print("  ours only: " + " ".join(sorted(o - r)))
+                row[mode] = counts
+            rows.append((name, row))
+    head = "%-16s" % "input" + "".join(" %8s %8s %8s" % (m + ":ref", "ours",
+                                                          "both")
+                                       for m in args.modes)
+    print(head)
+    totals = {m: [0, 0, 0] for m in args.modes}
+    for name, row in rows:
+        line = "%-16s" % name
+        for m in args.modes:
+            if m in row:
+                line += " %8d %8d %8d" % tuple(row[m])
+                totals[m] = [a + b for a, b in zip(totals[m], row[m])]
+            else:
+                line += " %8s %8s %8s" % ("-", "-", "-")
+        print(line)
+    print("%-16s" % "total"
+          + "".join(" %8d %8d %8d" % tuple(totals[m]) for m in args.modes))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+"""Missed-opportunity counts from -pass-remarks-output files.
+
+Usage: bench/remarks.py <remarks.yaml>... [--pass P...] [--by-opcode]
+
+Reads the YAML remark streams opt writes with -pass-remarks-output (one per
+compiled file) and prints, per pass, how many remarks of each kind and name
+there were, most frequent first: for unit-licm the Hoisted count against the
+reasons instructions stayed in their loop, for unit-sccp the Folded count
+against the reasons values went bottom. --by-opcode splits every row by the
+opcode the remark is about where it names one. Only the fields needed here
+are parsed, so no YAML module is required.
+"""
+import argparse
+import collections
+import re
+
+
+def remarks(path):
+    """(kind, pass, name, opcode) of every remark in path"""
+    for doc in open(path).read().split("\n--- !"):
+        kind = re.match(r"(?:--- !)?(\w+)", doc)
+        name = re.search(r"^Name:\s+(\S+)", doc, re.M)
+        pas = re.search(r"^Pass:\s+(\S+)", doc, re.M)
+        if not (kind and name and pas):
+            continue
+        opcode = re.search(r"^  - Opcode:\s+(\S+)", doc, re.M)
+        yield (kind.group(1), pas.group(1), name.group(1),
+               opcode.group(1) if opcode else "")
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("files", nargs="+")
+    ap.add_argument("--pass", dest="passes", nargs="+")
+    ap.add_argument("--by-opcode", action="store_true")
+    args = ap.parse_args()
+    counts = collections.Counter()
+    for path in args.files:
+        for kind, pas, name, opcode in remarks(path):
+            if args.passes and pas not in args.passes:
+                continue
+            counts[(pas, kind, name, opcode if args.by_opcode else "")] += 1
+    passes = sorted({key[0] for key in counts})
+    for pas in passes:
+        rows = [(n, key) for key, n in counts.items() if key[0] == pas]
+        total = sum(n for n, _ in rows)
+        print("%s (%d remarks)" % (pas, total))
+        for n, (_, kind, name, opcode) in sorted(rows, reverse=True):
+            print("  %-7s %-20s %-14s %8d %6.1f%%"
+                  % (kind, name, opcode, n, 100.0 * n / total))
+
+
+if __name__ == "__main__":
+    main()
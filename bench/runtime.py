@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""Runtime benchmark of the official_tests programs under three pipelines.
+
+Usage: bench/runtime.py <libUnitProject.so> [--runs N] [--tests name...] [--O3]
+
+Every program is compiled by clang at -O0 (optnone disabled), optimized by
+opt under each pipeline, and linked from llc -O2 output:
+
+  base   OPT0FLAGS of test_c/Makefile, the cleanup passes alone
+  unit   OPTFLAGS of test_c/Makefile, with unit-sccp and unit-licm
+  stock  the same pipeline with LLVM's own sccp and licm in their place
+
+With --O3, unit is -O3 with -unit-default-pipeline (the unit passes at
+its extension points and the interprocedural ones) and stock is -O3
+without the plugin.
+Each binary runs --runs times and its stdout must match the base binary's,
+or the row is marked MISMATCH. Prints the median wall time under every
+pipeline and the speedup of unit and stock over base, and the geomean over
+the rows that are ok. Set LLVM to pick the tools and CC to pick the compiler
+(default clang).
+"""
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+import pipelines
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+TESTS = os.path.join(HERE, "..", "official_tests")
+# PR491.c only checks a miscompile and runs for no measurable time
+SKIP = ["PR491"]
+
+# name, passes, whether the plugin is loaded, options of the plugin
+PIPELINES = [
+    ("base", pipelines.OPT0FLAGS, True, []),
+    ("unit", pipelines.OPTFLAGS, True, []),
+    ("stock", pipelines.STOCK, True, []),
+]
+O3_PIPELINES = [
+    ("base", pipelines.OPT0FLAGS, False, []),
+    ("unit", "default<O3>", True, ["-unit-default-pipeline"]),
+    ("stock", "default<O3>", False, []),
+]
+
+
+def tool(name):
+    if "LLVM" in os.environ:
+        return os.path.join(os.environ["LLVM"], "bin", name)
+    return name
+
+
+def compiler():
+    return os.environ.get("CC", tool("clang"))
+
+
+def build(ll, lib, options, passes, stem):
+    """Optimize ll under passes and link it as stem.exe"""
+    cmd = [tool("opt"), "-S", "-passes=" + passes, ll, "-o", stem + ".opt.ll"]
+    if lib:
+        # options of a plugin are only known to opt if -load loads it too
+        cmd[1:1] = ["-load=" + lib, "-load-pass-plugin=" + lib] + options
+    with open(os.devnull, "w") as null:
+        # the plugin logs to stderr
+        subprocess.run(cmd, check=True, stderr=null)
+    subprocess.run([tool("llc"), "-O2", stem + ".opt.ll", "-o", stem + ".s"],
+                   check=True)
+    subprocess.run([compiler(), stem + ".s", "-o", stem + ".exe", "-lm"],
+                   check=True)
+    return stem + ".exe"
+
+
+def run(exe, runs):
+    """Median wall time over runs runs of exe, and its output"""
+    times, out = [], None
+    for _ in range(runs):
+        start = time.time()
+        proc = subprocess.run([exe], stdout=subprocess.PIPE,
+                              stderr=subprocess.DEVNULL)
+        times.append(time.time() - start)
+        out = proc.stdout
+    times.sort()
+    return times[len(times) // 2], out
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("plugin")
+    ap.add_argument("--runs", type=int, default=5)
+    ap.add_argument("--tests", nargs="*")
+    ap.add_argument("--O3", action="store_true")
+    args = ap.parse_args()
+    lib = os.path.abspath(args.plugin)
+    if not shutil.which(compiler()):
+        sys.exit("%s not found, set CC or LLVM" % compiler())
+    names = args.tests or sorted(f[:-2] for f in os.listdir(TESTS)
+                                 if f.endswith(".c") and f[:-2] not in SKIP)
+    print("%-14s %9s %9s %9s %8s %8s  %s"
+          % ("test", "base", "unit", "stock", "unit", "stock", "output"))
+    speedups = {"unit": [], "stock": []}
+    with tempfile.TemporaryDirectory() as work:
+        for name in names:
+            ll = os.path.join(work, name + ".ll")
+            times, outs = {}, {}
+            try:
+                subprocess.run([compiler(), "-emit-llvm", "-S",
+                                os.path.join(TESTS, name + ".c"), "-o", ll,
+                                "-Xclang", "-disable-O0-optnone"], check=True)
+                for pipe, passes, plugin, options in (
+                        O3_PIPELINES if args.O3 else PIPELINES):
+                    exe = build(ll, lib if plugin else None, options, passes,
+                                os.path.join(work, name + "." + pipe))
+                    times[pipe], outs[pipe] = run(exe, args.runs)
+            except subprocess.CalledProcessError as e:
+                print("%-14s build failed: %s" % (name, e.cmd[0]))
+                continue
+            same = all(out == outs["base"] for out in outs.values())
+            ups = [times["base"] / times[p] for p in ("unit", "stock")]
+            if same:
+                speedups["unit"].append(ups[0])
+                speedups["stock"].append(ups[1])
+            print("%-14s %8.3fs %8.3fs %8.3fs %7.2fx %7.2fx  %s"
+                  % (name, times["base"], times["unit"], times["stock"],
+                     ups[0], ups[1], "ok" if same else "MISMATCH"))
+    for pipe, ups in speedups.items():
+        if ups:
+            prod = 1.0
+            for u in ups:
+                prod *= u
+            print("geomean speedup %-5s %.3fx over %d tests"
+                  % (pipe, prod ** (1.0 / len(ups)), len(ups)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""Compile-time scaling of the unit passes on synthetic IR.
+
+Usage: bench/scaling.py <libUnitProject.so> [--shapes S...] [--sizes N...]
+
+Every gen_ir.py shape is generated at each size and run through unit-licm
+and unit-sccp separately; the times are the ones -time-passes reports for
+UnitLoopAnalysis, UnitLICM and UnitSCCP themselves, median of --runs runs.
+For each pass and shape the exponent k of time ~ size^k is fitted by least
+squares on the log-log points, ignoring times under --floor seconds that
+are mostly noise. An exponent above --limit is flagged, so a pass turning
+quadratic shows up as a number rather than a hunch. Set LLVM to pick the
+opt binary.
+"""
+import argparse
+import math
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SHAPES = ["nest", "wide", "memops", "cfg", "phis", "diamonds"]
+# Pipeline to run and the -time-passes rows it reports
+RUNS = [("unit-licm", ["cs426::UnitLoopAnalysis", "cs426::UnitLICM"]),
+        ("unit-sccp", ["cs426::UnitSCCP"])]
+COLUMNS = [name for _, names in RUNS for name in names]
+
+
+def pass_times(opt, lib, passes, bc):
+    with tempfile.NamedTemporaryFile(suffix=".txt") as report:
+        with open(os.devnull, "w") as null:
+            subprocess.run([opt, "-load-pass-plugin=" + lib,
+                            "-passes=" + passes, "-disable-output",
+                            "-time-passes", "-info-output-file=" + report.name,
+                            bc], stdout=null, stderr=null, check=True)
+        times = {}
+        for line in open(report.name):
+            name = line.split()[-1] if line.strip() else ""
+            if name.startswith("cs426::"):
+                # columns: user, [system, user+system,] wall; each "t (p%)".
+                # A column whose total is zero is left out, wall is last
+                times[name] = float(re.findall(r"([\d.]+) \(", line)[-1])
+        return times
+
+
+def fit(points, floor):
+    """Least squares slope of log(time) over log(size)"""
+    pts = [(math.log(n), math.log(t)) for n, t in points if t >= floor]
+    if len(pts) < 2:
+        return None
+    mx = sum(x for x, _ in pts) / len(pts)
+    my = sum(y for _, y in pts) / len(pts)
+    sxx = sum((x - mx) ** 2 for x, _ in pts)
+    return sum((x - mx) * (y - my) for x, y in pts) / sxx if sxx else None
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("plugin")
+    ap.add_argument("--shapes", nargs="+", default=SHAPES)
+    ap.add_argument("--sizes", nargs="+", type=int,
+                    default=[250, 500, 1000, 2000])
+    ap.add_argument("--funcs", type=int, default=1)
+    ap.add_argument("--runs", type=int, default=3)
+    ap.add_argument("--floor", type=float, default=0.002)
+    ap.add_argument("--limit", type=float, default=1.5)
+    args = ap.parse_args()
+    opt = os.path.join(os.environ["LLVM"], "bin", "opt") \
+        if "LLVM" in os.environ else "opt"
+    lib = os.path.abspath(args.plugin)
+    print("%-9s %6s" % ("shape", "size")
+          + "".join(" %16s" % c[7:] for c in COLUMNS))
+    fits = []
+    for shape in args.shapes:
+        points = {c: [] for c in COLUMNS}
+        for size in args.sizes:
+            with tempfile.NamedTemporaryFile(suffix=".bc") as bc:
+                ir = subprocess.run([sys.executable,
+                                     os.path.join(HERE, "gen_ir.py"), shape,
+                                     str(size), "--funcs", str(args.funcs)],
+                                    check=True, stdout=subprocess.PIPE).stdout
+                subprocess.run([opt, "-o", bc.name], input=ir, check=True)
+                row = {}
+                for passes, names in RUNS:
+                    samples = [pass_times(opt, lib, passes, bc.name)
+                               for _ in range(args.runs)]
+                    for name in names:
+                        ts = sorted(s.get(name, 0.0) for s in samples)
+                        row[name] = ts[len(ts) // 2]
+                        points[name].append((size, row[name]))
+            print("%-9s %6d" % (shape, size)
+                  + "".join(" %15.4fs" % row[c] for c in COLUMNS))
+        for c in COLUMNS:
+            fits.append((shape, c, fit(points[c], args.floor)))
+    print("\n%-9s %-16s %8s" % ("shape", "pass", "exponent"))
+    for shape, c, k in fits:
+        if k is None:
+            print("%-9s %-16s %8s" % (shape, c[7:], "-"))
+        else:
+            print("%-9s %-16s %8.2f%s" % (shape, c[7:], k,
+                                           "  SUPERLINEAR" if k > args.limit
+                                           else ""))
+
+
+if __name__ == "__main__":
+    main()
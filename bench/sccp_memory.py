@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+"""Measure peak memory and time of unit-sccp on a large synthetic module.
+
+Usage: bench/sccp_memory.py <libUnitProject.so>... [--size K] [--funcs N]
+
+Every plugin runs on the same module from gen_ir.py (shape "phis"), whose
+loop-carried values are constant on the first visit and bottom afterwards,
+so the solver produces many intermediate values it never writes back.
+Reports the peak RSS of opt and the wall time; the parse-only row is the
+baseline of just reading the module. Set LLVM to pick the opt binary.
+"""
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+
+def run(cmd):
+    start = time.time()
+    with open(os.devnull, "w") as null:
+        proc = subprocess.Popen(cmd, stdout=null, stderr=null)
+        _, status, usage = os.wait4(proc.pid, 0)
+    if status != 0:
+        sys.exit("failed: " + " ".join(cmd))
+    return usage.ru_maxrss / 1024.0, time.time() - start
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("plugins", nargs="+")
+    ap.add_argument("--size", type=int, default=2000)
+    ap.add_argument("--funcs", type=int, default=200)
+    ap.add_argument("--runs", type=int, default=3)
+    args = ap.parse_args()
+    opt = os.path.join(os.environ["LLVM"], "bin", "opt") \
+        if "LLVM" in os.environ else "opt"
+    with tempfile.NamedTemporaryFile(suffix=".bc") as bc:
+        ir = subprocess.run([sys.executable, os.path.join(HERE, "gen_ir.py"),
+                             "phis", str(args.size), "--funcs",
+                             str(args.funcs)], check=True,
+                            stdout=subprocess.PIPE).stdout
+        subprocess.run([opt, "-o", bc.name], input=ir, check=True)
+        rows = [("parse only", [opt, "-disable-output", bc.name])]
+        for lib in args.plugins:
+            rows.append((lib, [opt, "-load-pass-plugin=" + lib,
+                               "-passes=unit-sccp", "-disable-output",
+                               bc.name]))
+        print("%-40s %12s %10s" % ("plugin", "peak RSS", "time"))
+        for name, cmd in rows:
+            res = [run(cmd) for _ in range(args.runs)]
+            rss = min(r[0] for r in res)
+            secs = sorted(r[1] for r in res)[len(res) // 2]
+            print("%-40s %9.1f MB %9.2fs" % (name[-40:], rss, secs))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""Micro-benchmark of the unit-sccp solver itself.
+
+Usage: bench/sccp_solver.py <libUnitProject.so>... [--size K] [--funcs N]
+
+Every plugin runs on the same gen_ir.py modules, one per shape, and the
+time is the one -time-passes reports for cs426::UnitSCCP alone, so parsing
+and verification stay out of the numbers. Reports the median wall time
+over --runs runs. Set LLVM to pick the opt binary.
+"""
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SHAPES = ["phis", "diamonds"]
+
+
+def pass_time(opt, lib, bc):
+    with tempfile.NamedTemporaryFile(suffix=".txt") as report:
+        with open(os.devnull, "w") as null:
+            subprocess.run([opt, "-load-pass-plugin=" + lib,
+                            "-passes=unit-sccp", "-disable-output",
+                            "-time-passes", "-info-output-file=" + report.name,
+                            bc], stdout=null, stderr=null, check=True)
+        for line in open(report.name):
+            if line.rstrip().endswith("cs426::UnitSCCP"):
+                # columns: user, [system, user+system,] wall; each "t (p%)".
+                # A column whose total is zero is left out, wall is last
+                return float(re.findall(r"([\d.]+) \(", line)[-1])
+    sys.exit("no UnitSCCP timing from " + lib)
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("plugins", nargs="+")
+    ap.add_argument("--size", type=int, default=200)
+    ap.add_argument("--funcs", type=int, default=20)
+    ap.add_argument("--runs", type=int, default=5)
+    args = ap.parse_args()
+    opt = os.path.join(os.environ["LLVM"], "bin", "opt") \
+        if "LLVM" in os.environ else "opt"
+    print("%-10s %-40s %10s" % ("shape", "plugin", "time"))
+    for shape in SHAPES:
+        with tempfile.NamedTemporaryFile(suffix=".bc") as bc:
+            ir = subprocess.run([sys.executable,
+                                 os.path.join(HERE, "gen_ir.py"), shape,
+                                 str(args.size), "--funcs", str(args.funcs)],
+                                check=True, stdout=subprocess.PIPE).stdout
+            subprocess.run([opt, "-o", bc.name], input=ir, check=True)
+            for lib in args.plugins:
+                times = sorted(pass_time(opt, lib, bc.name)
+                               for _ in range(args.runs))
+                print("%-10s %-40s %9.3fs"
+                      % (shape, lib[-40:], times[len(times) // 2]))
+
+
+if __name__ == "__main__":
+    main()
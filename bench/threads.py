@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""Scaling of unit-opt -j with the number of threads on one large module.
+
+Usage: bench/threads.py <unit-opt> [--shape S] [--size N] [--funcs F]
+                        [--threads T...] [--shards N] [--runs N]
+
+gen_ir.py makes one module of --funcs functions of the given shape and
+size, and unit-opt runs the OPTFLAGS pipeline of test_c/Makefile on it,
+serially and with each -j of --threads (default 2 up to the number of
+CPUs). Reports the median optimize time unit-opt prints for the module,
+the speedup over the serial run, and whether the output is the serial one
+byte for byte. Rows with more threads than CPUs are marked oversubscribed:
+their speedup shows the cost of sharding, not scaling. The interprocedural passes between the function stages
+(inline, globaldce) still run on the whole module, so they bound the
+speedup.
+"""
+import argparse
+import filecmp
+import os
+import subprocess
+import sys
+import tempfile
+
+import pipelines
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+
+def optimize_time(driver, ll, out, flags, runs):
+    """Median of the optimize column of unit-opt's report over runs runs"""
+    times = []
+    for _ in range(runs):
+        err = subprocess.run([driver, "-passes=" + pipelines.OPTFLAGS, "-S",
+                              ll, "-o", out] + flags, check=True,
+                             stderr=subprocess.PIPE,
+                             universal_newlines=True).stderr
+        total = [line for line in err.splitlines()
+                 if line.endswith(" total")][0]
+        times.append(float(total.split()[1]))
+    times.sort()
+    return times[len(times) // 2]
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("driver")
+    ap.add_argument("--shape", default="wide")
+    ap.add_argument("--size", type=int, default=200)
+    ap.add_argument("--funcs", type=int, default=400)
+    ap.add_argument("--threads", nargs="+", type=int,
+                    default=list(range(2, max(os.cpu_count() or 1, 2) + 1)))
+    ap.add_argument("--shards", type=int)
+    ap.add_argument("--runs", type=int, default=3)
+    args = ap.parse_args()
+    with tempfile.TemporaryDirectory() as work:
+        ll = os.path.join(work, "in.ll")
+        with open(ll, "w") as f:
+            subprocess.run([sys.executable, os.path.join(HERE, "gen_ir.py"),
+                            args.shape, str(args.size), "--funcs",
+                            str(args.funcs)], stdout=f, check=True)
+        serial_out = os.path.join(work, "serial.ll")
+        serial = optimize_time(args.driver, ll, serial_out, [], args.runs)
+        print("%-8s %10s %8s  %s" % ("threads", "optimize", "speedup",
+                                     "output"))
+        print("%-8s %9.3fs %7.2fx  %s" % ("serial", serial, 1.0, "-"))
+        for t in args.threads:
+            out = os.path.join(work, "j%d.ll" % t)
+            flags = ["-j=%d" % t]
+            if args.shards:
+                flags.append("-shards=%d" % args.shards)
+            time = optimize_time(args.driver, ll, out, flags, args.runs)
+            same = filecmp.cmp(serial_out, out, shallow=False)
+            print("%-8d %9.3fs %7.2fx  %s%s"
+                  % (t, time, serial / time, "same" if same else "DIFFERS",
+                     ", oversubscribed" if t > (os.cpu_count() or 1) else ""))
+    print("%d cpus, %s x %d, size %d" % (os.cpu_count() or 1, args.shape,
+                                         args.funcs, args.size))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+"""Compile-time cost of the unit passes' logging on the official_tests.
+
+Usage: bench/trace_cost.py <libUnitProject.so>... [--runs N] [--trace L]
+
+Every program is compiled by clang at -O0 (optnone disabled) and each
+plugin runs the OPTFLAGS pipeline of test_c/Makefile on it, with stderr
+going to a file as it would on a terminal. Reports the median wall time of
+the whole opt run per plugin, the bytes it logged, and the speedup of each
+plugin over the first. Compare a build from before UnitTrace.h (which logs
+everything unconditionally) with Debug and Release builds after it; with
+--trace L the plugins also get -unit-trace=all -unit-trace-level=L, the
+cost of tracing when it is wanted. Set LLVM to pick the tools and CC to
+pick the compiler (default clang).
+"""
+import argparse
+import os
+import subprocess
+import tempfile
+import time
+
+import pipelines
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+TESTS = os.path.join(HERE, "..", "official_tests")
+
+
+def tool(name):
+    if "LLVM" in os.environ:
+        return os.path.join(os.environ["LLVM"], "bin", name)
+    return name
+
+
+def compile_time(lib, ll, trace, runs, log):
+    """Median wall time of opt over runs runs, and the bytes it logged"""
+    cmd = [tool("opt"), "-load-pass-plugin=" + lib,
+           "-passes=" + pipelines.OPTFLAGS, "-disable-output", ll]
+    if trace is not None:
+        # plugin options are only parsed for libraries given to -load
+        cmd += ["-load=" + lib, "-unit-trace=all",
+                "-unit-trace-level=%d" % trace]
+    times = []
+    for _ in range(runs):
+        with open(log, "w") as err:
+            start = time.time()
+            subprocess.run(cmd, stderr=err, check=True)
+            times.append(time.time() - start)
+    times.sort()
+    return times[len(times) // 2], os.path.getsize(log)
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("plugins", nargs="+")
+    ap.add_argument("--runs", type=int, default=5)
+    ap.add_argument("--tests", nargs="*")
+    ap.add_argument("--trace", type=int)
+    args = ap.parse_args()
+    libs = [os.path.abspath(p) for p in args.plugins]
+    names = args.tests or sorted(f[:-2] for f in os.listdir(TESTS)
+                                 if f.endswith(".c"))
+    print("%-14s" % "test" + "".join(" %9s %10s" % ("#%d" % i, "log")
+                                     for i in range(len(libs)))
+          + "".join(" %7s" % ("#%d" % i) for i in range(1, len(libs))))
+    totals = [0.0] * len(libs)
+    with tempfile.TemporaryDirectory() as work:
+        log = os.path.join(work, "stderr.txt")
+        for name in names:
+            ll = os.path.join(work, name + ".ll")
+            subprocess.run([os.environ.get("CC", tool("clang")),
+                            "-emit-llvm", "-S",
+                            os.path.join(TESTS, name + ".c"), "-o", ll,
+                            "-Xclang", "-disable-O0-optnone"], check=True)
+            row = [compile_time(lib, ll, args.trace, args.runs, log)
+                   for lib in libs]
+            for i, (t, _) in enumerate(row):
+                totals[i] += t
+            print("%-14s" % name
+                  + "".join(" %8.3fs %10d" % r for r in row)
+                  + "".join(" %6.2fx" % (row[0][0] / t) for t, _ in row[1:]))
+    print("%-14s" % "total"
+          + "".join(" %8.3fs %10s" % (t, "") for t in totals)
+          + "".join(" %6.2fx" % (totals[0] / t) for t in totals[1:]))
+    for i, lib in enumerate(libs):
+        print("#%d %s" % (i, lib))
+
+
+if __name__ == "__main__":
+    main()
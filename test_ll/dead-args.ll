@@ -0,0 +1,92 @@
+; RUN: %opt -passes=unit-dead-args -S %s | FileCheck %s
+
+declare i32 @opaque()
+declare i32 @__gxx_personality_v0(...)
+
+; Every call passes 3 for %a: it is substituted and dropped
+; CHECK-LABEL: define internal i32 @basic(i32 %b)
+; CHECK-NEXT: %s = add i32 3, %b
+define internal i32 @basic(i32 %a, i32 %b) {
+  %s = add i32 %a, %b
+  ret i32 %s
+}
+
+; The call passing 7 is only reached through a switch
+; CHECK-LABEL: define internal i32 @switch_arg(i32 %a)
+; CHECK-NEXT: ret i32 %a
+define internal i32 @switch_arg(i32 %a) {
+  ret i32 %a
+}
+
+; The call passing 2 is only reached through an invoke
+; CHECK-LABEL: define internal i32 @invoke_arg(i32 %a)
+; CHECK-NEXT: ret i32 %a
+define internal i32 @invoke_arg(i32 %a) {
+  ret i32 %a
+}
+
+; The return of 2 is only reached through a switch
+; CHECK-LABEL: define internal i32 @switch_ret(
+; CHECK: ret i32 1
+; CHECK: ret i32 2
+define internal i32 @switch_ret(i32 %x) {
+entry:
+  %c = icmp eq i32 %x, 0
+  br i1 %c, label %one, label %sw
+sw:
+  switch i32 %x, label %one [ i32 5, label %two ]
+one:
+  ret i32 1
+two:
+  ret i32 2
+}
+
+; Each call bumps its own copy of @g, not @g itself
+%S = type { i32, i32 }
+@g = internal global %S { i32 15, i32 0 }
+
+; CHECK-LABEL: define internal i32 @bump(%S* byval(%S) %p)
+; CHECK-NEXT: %f = getelementptr %S, %S* %p, i32 0, i32 0
+define internal i32 @bump(%S* byval(%S) %p) {
+  %f = getelementptr %S, %S* %p, i32 0, i32 0
+  %v = load i32, i32* %f
+  %n = add i32 %v, 1
+  store i32 %n, i32* %f
+  ret i32 %n
+}
+
+; CHECK-LABEL: @main(
+; CHECK: %b1 = call i32 @basic(i32 %x)
+; CHECK: %r = call i32 @switch_ret(i32 %x)
+; CHECK: ret i32 %t
+define i32 @main() personality i32 (...)* @__gxx_personality_v0 {
+entry:
+  %x = call i32 @opaque()
+  %b1 = call i32 @basic(i32 3, i32 %x)
+  %b2 = call i32 @basic(i32 3, i32 1)
+  %s1 = call i32 @switch_arg(i32 5)
+  %i1 = call i32 @invoke_arg(i32 1)
+  %r = call i32 @switch_ret(i32 %x)
+  switch i32 %x, label %join [ i32 1, label %case ]
+case:
+  %s2 = call i32 @switch_arg(i32 7)
+  br label %join
+join:
+  %s = phi i32 [ %s1, %entry ], [ %s2, %case ]
+  %y = invoke i32 @opaque() to label %ok unwind label %lp
+ok:
+  %i2 = call i32 @invoke_arg(i32 2)
+  %t1 = add i32 %b1, %b2
+  %t2 = add i32 %t1, %s
+  %t3 = add i32 %t2, %i1
+  %t4 = add i32 %t3, %i2
+  %t5 = add i32 %t4, %r
+  %g1 = call i32 @bump(%S* byval(%S) @g)
+  %g2 = call i32 @bump(%S* byval(%S) @g)
+  %t6 = add i32 %g1, %g2
+  %t = add i32 %t5, %t6
+  ret i32 %t
+lp:
+  %l = landingpad { i8*, i32 } cleanup
+  resume { i8*, i32 } %l
+}
@@ -0,0 +1,29 @@
+; RUN: %opt -passes='default<O2>' -debug-pass-manager -disable-output %s 2>&1 | FileCheck %s --check-prefix=STOCK
+; RUN: %opt -load=%plugin -unit-default-pipeline -passes='default<O2>' -debug-pass-manager -disable-output %s 2>&1 | FileCheck %s --check-prefix=UNIT
+; RUN: %opt -load=%plugin -unit-default-pipeline -passes='default<O2>' -debug-pass-manager -disable-output %s 2>&1 | FileCheck %s --check-prefix=UNIT-O2
+; RUN: %opt -load=%plugin -unit-default-pipeline -O3 -debug-pass-manager -disable-output %s 2>&1 | FileCheck %s --check-prefixes=UNIT,UNIT-O3
+
+; Loading the plugin leaves the default pipeline alone; -unit-default-pipeline
+; adds all of the unit passes, and unit-specialize at O3
+; STOCK-NOT: Unit
+; UNIT-DAG: Running pass: cs426::UnitGlobalSCCP
+; UNIT-DAG: Running pass: cs426::UnitDeadArgs
+; UNIT-DAG: Running pass: cs426::UnitSCCP
+; UNIT-DAG: Running pass: cs426::UnitLoopLICM
+; UNIT-O2-NOT: UnitSpecialize
+; UNIT-O3-DAG: Running pass: cs426::UnitSpecialize
+
+@g = global i32 0
+
+define i32 @main(i32 %n) {
+entry:
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %v = load volatile i32, i32* @g
+  %i.next = add i32 %i, %v
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+exit:
+  ret i32 %i.next
+}
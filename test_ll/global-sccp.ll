@@ -0,0 +1,65 @@
+; RUN: %opt -passes=unit-global-sccp -S %s | FileCheck %s
+
+; @g is always 5: main stores it before anything can load the initializer
+; CHECK-NOT: @g =
+; CHECK: @h = internal global i32 0
+; CHECK: @k = internal global i32 0
+@g = internal global i32 0
+@h = internal global i32 0
+@k = internal global i32 0
+
+declare i32 @opaque()
+declare i32 @__gxx_personality_v0(...)
+
+; CHECK-LABEL: @get_g(
+; CHECK-NEXT: ret i32 5
+define internal i32 @get_g() {
+  %v = load i32, i32* @g
+  ret i32 %v
+}
+
+; The store of 7 is only reached through a switch
+; CHECK-LABEL: @switch_store(
+; CHECK: store i32 7, i32* @h
+; CHECK: %v = load i32, i32* @h
+; CHECK-NEXT: ret i32 %v
+define internal i32 @switch_store() {
+entry:
+  %x = call i32 @opaque()
+  switch i32 %x, label %join [ i32 1, label %case ]
+case:
+  store i32 7, i32* @h
+  br label %join
+join:
+  %v = load i32, i32* @h
+  ret i32 %v
+}
+
+; The store of 3 is only reached through an invoke
+; CHECK-LABEL: @invoke_store(
+; CHECK: store i32 3, i32* @k
+; CHECK: %v = load i32, i32* @k
+; CHECK-NEXT: ret i32 %v
+define internal i32 @invoke_store() personality i32 (...)* @__gxx_personality_v0 {
+entry:
+  %x = invoke i32 @opaque() to label %ok unwind label %lp
+ok:
+  store i32 3, i32* @k
+  br label %done
+done:
+  %v = load i32, i32* @k
+  ret i32 %v
+lp:
+  %l = landingpad { i8*, i32 } cleanup
+  resume { i8*, i32 } %l
+}
+
+define i32 @main() {
+  store i32 5, i32* @g
+  %a = call i32 @get_g()
+  %b = call i32 @switch_store()
+  %c = call i32 @invoke_store()
+  %s = add i32 %a, %b
+  %t = add i32 %s, %c
+  ret i32 %t
+}
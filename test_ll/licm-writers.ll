@@ -0,0 +1,89 @@
+; RUN: %opt -passes=unit-licm -S %s | FileCheck %s
+; RUN: %opt -passes='loop-mssa(unit-licm)' -verify-memoryssa -S %s | FileCheck %s
+
+@g = global i32 0
+@h = global i32 0
+
+declare void @bump()
+declare void @llvm.memset.p0i8.i64(i8*, i8, i64, i1)
+
+; The only write in the loop is a store that does not alias @g
+; CHECK-LABEL: @stores_only(
+; CHECK: entry:
+; CHECK: %v = load i32, i32* @g
+; CHECK: loop:
+define i32 @stores_only(i32 %n) {
+entry:
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  store i32 %i, i32* @h
+  %v = load i32, i32* @g
+  %i.next = add i32 %i, %v
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+exit:
+  ret i32 %i.next
+}
+
+; @bump may write @g, so the load stays after it
+; CHECK-LABEL: @call_writes(
+; CHECK: loop:
+; CHECK: call void @bump()
+; CHECK-NEXT: %v = load i32, i32* @g
+define i32 @call_writes(i32 %n) {
+entry:
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  call void @bump()
+  %v = load i32, i32* @g
+  %i.next = add i32 %i, %v
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+exit:
+  ret i32 %i.next
+}
+
+; So may the memset, and the store cannot move past it either
+; CHECK-LABEL: @memset_writes(
+; CHECK: loop:
+; CHECK: call void @llvm.memset
+; CHECK-NEXT: %v = load i32, i32* @g
+; CHECK-NEXT: store i32 1, i32* @h
+define i32 @memset_writes(i8* %p, i32 %n) {
+entry:
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  call void @llvm.memset.p0i8.i64(i8* %p, i8 0, i64 4, i1 false)
+  %v = load i32, i32* @g
+  store i32 1, i32* @h
+  %i.next = add i32 %i, %v
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+exit:
+  ret i32 %i.next
+}
+
+; Each iteration reads @g before it stores 0 there: the store stays, or the
+; first iteration would read the 0
+; CHECK-LABEL: @store_after_read(
+; CHECK: loop:
+; CHECK: %v = load i32, i32* @g
+; CHECK: store i32 0, i32* @g
+define i32 @store_after_read(i32 %n) {
+entry:
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %s = phi i32 [ 0, %entry ], [ %s.next, %loop ]
+  %v = load i32, i32* @g
+  %s.next = add i32 %s, %v
+  store i32 0, i32* @g
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+exit:
+  ret i32 %s.next
+}
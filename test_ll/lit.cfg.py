@@ -0,0 +1,22 @@
+# Regression tests of the unit passes. ctest runs them through lit with the
+# plugin just built; by hand:
+#   lit -sv test_ll --param plugin=build/libUnitProject.so \
+#       --param llvm_tools_dir=<LLVM>/bin
+import os
+
+import lit.formats
+
+config.name = "UnitProject"
+config.test_format = lit.formats.ShTest(True)
+config.suffixes = [".ll"]
+config.test_source_root = os.path.dirname(__file__)
+config.test_exec_root = lit_config.params.get("obj", config.test_source_root)
+
+tools = lit_config.params.get("llvm_tools_dir")
+if tools:
+    config.environment["PATH"] = os.pathsep.join(
+        [tools, config.environment.get("PATH", "")])
+plugin = os.path.abspath(lit_config.params.get("plugin",
+                                               "build/libUnitProject.so"))
+config.substitutions.append(("%opt", "opt -load-pass-plugin=" + plugin))
+config.substitutions.append(("%plugin", plugin))
@@ -0,0 +1,64 @@
+; RUN: %opt -passes=unit-sccp -pass-remarks=unit-sccp -pass-remarks-missed=unit-sccp -pass-remarks-output=%t.sccp.yaml -disable-output %s 2>&1 | FileCheck %s --check-prefix=SCCP
+; RUN: FileCheck %s --check-prefix=SCCP-YAML < %t.sccp.yaml
+; RUN: %opt -passes=unit-licm -pass-remarks=unit-licm -pass-remarks-missed=unit-licm -pass-remarks-output=%t.licm.yaml -disable-output %s 2>&1 | FileCheck %s --check-prefix=LICM
+; RUN: FileCheck %s --check-prefix=LICM-YAML < %t.licm.yaml
+
+; Folded and missed remarks of unit-sccp, selected by its pipeline name
+; SCCP-DAG: remark: <unknown>:0:0: folded add to 5
+; SCCP-DAG: remark: <unknown>:0:0: not constant: operand x is not constant
+; SCCP-DAG: remark: <unknown>:0:0: not constant: loads memory the solver does not track
+
+; SCCP-YAML:      --- !Passed
+; SCCP-YAML-NEXT: Pass: unit-sccp
+; SCCP-YAML-NEXT: Name: Folded
+; SCCP-YAML-NEXT: Function: fold
+; SCCP-YAML:      --- !Missed
+; SCCP-YAML-NEXT: Pass: unit-sccp
+; SCCP-YAML-NEXT: Name: OverdefinedOperand
+; SCCP-YAML-NEXT: Function: fold
+; SCCP-YAML:      - Operand: x
+
+@g = global i32 0
+@h = global i32 0
+
+define i32 @fold(i32 %x) {
+  %a = add i32 2, 3
+  %b = add i32 %a, %x
+  ret i32 %b
+}
+
+; The load of @g leaves the loop; the load of @h and the store to it stay
+; LICM-DAG: remark: <unknown>:0:0: hoisted load to entry
+; LICM-DAG: remark: <unknown>:0:0: not hoisted: load may alias store
+; LICM-DAG: remark: <unknown>:0:0: not hoisted: store may alias load
+
+; LICM-YAML:      --- !Passed
+; LICM-YAML-NEXT: Pass: unit-licm
+; LICM-YAML-NEXT: Name: Hoisted
+; LICM-YAML-NEXT: Function: loop
+; LICM-YAML:      --- !Missed
+; LICM-YAML-NEXT: Pass: unit-licm
+; LICM-YAML-NEXT: Name: LoadClobbered
+; LICM-YAML-NEXT: Function: loop
+; LICM-YAML:      - Store: store
+; LICM-YAML:      --- !Missed
+; LICM-YAML-NEXT: Pass: unit-licm
+; LICM-YAML-NEXT: Name: StoreAliased
+; LICM-YAML-NEXT: Function: loop
+; LICM-YAML:      - Read: load
+
+define i32 @loop(i32 %n) {
+entry:
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %v = load i32, i32* @g
+  %v2 = load i32, i32* @h
+  store i32 %v, i32* @h
+  %s = add i32 %v, %v2
+  %i.next = add i32 %i, %s
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+exit:
+  ret i32 %i.next
+}
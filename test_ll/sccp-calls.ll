@@ -0,0 +1,56 @@
+; RUN: %opt -passes=unit-sccp -S %s | FileCheck %s
+
+declare double @sqrt(double)
+declare double @llvm.fabs.f64(double)
+declare i32 @llvm.ctpop.i32(i32)
+declare { i32, i1 } @llvm.umul.with.overflow.i32(i32, i32)
+
+; Library calls and intrinsics on constants fold
+; CHECK-LABEL: @sqrt_const(
+; CHECK: ret double 4.000000e+00
+define double @sqrt_const() {
+  %a = fadd double 8.0, 8.0
+  %s = call double @sqrt(double %a)
+  ret double %s
+}
+
+; CHECK-LABEL: @intrinsics(
+; CHECK: ret i32 11
+define i32 @intrinsics() {
+  %f = call double @llvm.fabs.f64(double -3.0)
+  %i = fptosi double %f to i32
+  %p = call i32 @llvm.ctpop.i32(i32 255)
+  %r = add i32 %i, %p
+  ret i32 %r
+}
+
+; A struct result folds field by field through extractvalue
+; CHECK-LABEL: @overflow(
+; CHECK: ret i32 1
+define i32 @overflow() {
+  %r = call { i32, i1 } @llvm.umul.with.overflow.i32(i32 65536, i32 65536)
+  %v = extractvalue { i32, i1 } %r, 0
+  %o = extractvalue { i32, i1 } %r, 1
+  %z = zext i1 %o to i32
+  %s = add i32 %v, %z
+  ret i32 %s
+}
+
+; So does an aggregate built by insertvalue
+; CHECK-LABEL: @insert(
+; CHECK: ret i32 7
+define i32 @insert(i32 %x) {
+  %a = insertvalue { i32, i32 } undef, i32 7, 0
+  %b = insertvalue { i32, i32 } %a, i32 %x, 1
+  %e = extractvalue { i32, i32 } %b, 0
+  ret i32 %e
+}
+
+; An argument that is not constant keeps the call
+; CHECK-LABEL: @sqrt_var(
+; CHECK: %s = call double @sqrt(double %x)
+; CHECK: ret double %s
+define double @sqrt_var(double %x) {
+  %s = call double @sqrt(double %x)
+  ret double %s
+}
@@ -0,0 +1,30 @@
+; RUN: %opt -passes=unit-sccp -S %s | FileCheck %s
+
+; Integer to FP conversions between types of different widths
+; CHECK-LABEL: @int_to_fp(
+; CHECK: ret double -7.000000e+00
+define double @int_to_fp() {
+  %a = sitofp i32 -7 to double
+  %b = uitofp i8 200 to float
+  %c = fpext float %b to double
+  %d = fcmp oeq double %c, 2.000000e+02
+  %e = select i1 %d, double %a, double 0.000000e+00
+  ret double %e
+}
+
+; CHECK-LABEL: @freeze(
+; CHECK: ret i32 5
+define i32 @freeze() {
+  %a = add i32 2, 3
+  %f = freeze i32 %a
+  %u = freeze i32 undef
+  %r = add i32 %f, %u
+  ret i32 %r
+}
+
+; CHECK-LABEL: @freeze_vector(
+; CHECK: %f = freeze <2 x i32> <i32 1, i32 undef>
+define <2 x i32> @freeze_vector() {
+  %f = freeze <2 x i32> <i32 1, i32 undef>
+  ret <2 x i32> %f
+}
@@ -0,0 +1,42 @@
+; RUN: %opt -passes=unit-sccp -S %s | FileCheck %s
+
+; The low bit of a shift left by one is known zero, whatever %x is
+; CHECK-LABEL: @low_bit(
+; CHECK-NOT: and
+; CHECK: ret i32 0
+define i32 @low_bit(i32 %x) {
+  %s = shl i32 %x, 1
+  %a = and i32 %s, 1
+  ret i32 %a
+}
+
+; Known bits reach through a phi, a zext and a compare
+; CHECK-LABEL: @phi_cmp(
+; CHECK: ret i1 false
+define i1 @phi_cmp(i8 %x, i1 %c) {
+entry:
+  %o = or i8 %x, 1
+  br i1 %c, label %a, label %b
+a:
+  %s = shl i8 %x, 1
+  %t = or i8 %s, 3
+  br label %join
+b:
+  br label %join
+join:
+  %p = phi i8 [ %t, %a ], [ %o, %b ]
+  %z = zext i8 %p to i32
+  %low = and i32 %z, 1
+  %r = icmp eq i32 %low, 0
+  ret i1 %r
+}
+
+; Only the low bit is known, so the value itself stays
+; CHECK-LABEL: @partial(
+; CHECK: %a = and i32 %s, 3
+; CHECK: ret i32 %a
+define i32 @partial(i32 %x) {
+  %s = shl i32 %x, 1
+  %a = and i32 %s, 3
+  ret i32 %a
+}
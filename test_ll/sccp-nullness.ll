@@ -0,0 +1,71 @@
+; RUN: %opt -passes=unit-sccp -S %s | FileCheck %s
+
+; A pointer loaded through is not null after the load
+; CHECK-LABEL: @after_load(
+; CHECK: ret i1 false
+define i1 @after_load(i32* %p) {
+  %v = load i32, i32* %p
+  %c = icmp eq i32* %p, null
+  ret i1 %c
+}
+
+; Nor is the base of an inbounds GEP stored through
+; CHECK-LABEL: @gep_base(
+; CHECK: ret i1 true
+define i1 @gep_base(i32* %p) {
+  %q = getelementptr inbounds i32, i32* %p, i64 1
+  store i32 0, i32* %q
+  %c = icmp ne i32* %p, null
+  ret i1 %c
+}
+
+; A null check decides the same check in the blocks it dominates
+; CHECK-LABEL: @checked(
+; CHECK: nonnull:
+; CHECK-NEXT: ret i1 false
+define i1 @checked(i8* %p) {
+entry:
+  %c = icmp ne i8* %p, null
+  br i1 %c, label %nonnull, label %null
+nonnull:
+  %d = icmp eq i8* %p, null
+  ret i1 %d
+null:
+  ret i1 true
+}
+
+; Before the load the pointer may still be null
+; CHECK-LABEL: @before_load(
+; CHECK: %c = icmp eq i32* %p, null
+; CHECK: ret i1 %c
+define i1 @before_load(i32* %p) {
+  %c = icmp eq i32* %p, null
+  %v = load i32, i32* %p
+  ret i1 %c
+}
+
+; A load on one arm says nothing where the arms join
+; CHECK-LABEL: @one_arm(
+; CHECK: join:
+; CHECK-NEXT: %c = icmp eq i32* %p, null
+; CHECK-NEXT: ret i1 %c
+define i1 @one_arm(i32* %p, i1 %b) {
+entry:
+  br i1 %b, label %use, label %join
+use:
+  %v = load i32, i32* %p
+  br label %join
+join:
+  %c = icmp eq i32* %p, null
+  ret i1 %c
+}
+
+; Neither does a volatile load, which may trap on purpose
+; CHECK-LABEL: @volatile(
+; CHECK: %c = icmp eq i32* %p, null
+; CHECK: ret i1 %c
+define i1 @volatile(i32* %p) {
+  %v = load volatile i32, i32* %p
+  %c = icmp eq i32* %p, null
+  ret i1 %c
+}
@@ -0,0 +1,31 @@
+; RUN: %opt -passes=unit-sccp -S %s | FileCheck %s
+
+declare { i32, i1 } @llvm.uadd.with.overflow.i32(i32, i32)
+declare { <2 x i32>, <2 x i1> } @llvm.sadd.with.overflow.v2i32(<2 x i32>, <2 x i32>)
+
+; %a < 100 on the edge into %small, so %a + 1 cannot wrap
+; CHECK-LABEL: @scalar(
+; CHECK: small:
+; CHECK-NOT: extractvalue
+; CHECK: ret i1 false
+define i1 @scalar(i32 %a) {
+entry:
+  %c = icmp ult i32 %a, 100
+  br i1 %c, label %small, label %big
+small:
+  %r = call { i32, i1 } @llvm.uadd.with.overflow.i32(i32 %a, i32 1)
+  %o = extractvalue { i32, i1 } %r, 1
+  ret i1 %o
+big:
+  ret i1 true
+}
+
+; Vector operands have no range; the call stays
+; CHECK-LABEL: @vector(
+; CHECK: %r = call { <2 x i32>, <2 x i1> } @llvm.sadd.with.overflow.v2i32
+; CHECK: ret <2 x i1> %o
+define <2 x i1> @vector(<2 x i32> %a) {
+  %r = call { <2 x i32>, <2 x i1> } @llvm.sadd.with.overflow.v2i32(<2 x i32> %a, <2 x i32> <i32 1, i32 2>)
+  %o = extractvalue { <2 x i32>, <2 x i1> } %r, 1
+  ret <2 x i1> %o
+}
@@ -0,0 +1,73 @@
+; RUN: %opt -passes=unit-sccp -S %s | FileCheck %s
+
+; %x < 5 on the edge into %small, so %x == 7 is false there, but not in
+; %big
+; CHECK-LABEL: @range(
+; CHECK: small:
+; CHECK-NEXT: ret i1 false
+; CHECK: big:
+; CHECK-NEXT: %f = icmp eq i32 %x, 7
+; CHECK-NEXT: ret i1 %f
+define i1 @range(i32 %x) {
+entry:
+  %c = icmp slt i32 %x, 5
+  br i1 %c, label %small, label %big
+small:
+  %e = icmp eq i32 %x, 7
+  ret i1 %e
+big:
+  %f = icmp eq i32 %x, 7
+  ret i1 %f
+}
+
+; Facts of nested branches narrow each other: 0 <= %x < 5 and %x != 0
+; CHECK-LABEL: @nested(
+; CHECK: inner:
+; CHECK-NEXT: ret i1 true
+define i1 @nested(i32 %x) {
+entry:
+  %c = icmp ult i32 %x, 5
+  br i1 %c, label %mid, label %out
+mid:
+  %d = icmp ne i32 %x, 0
+  br i1 %d, label %inner, label %out
+inner:
+  %e = icmp sgt i32 %x, 0
+  ret i1 %e
+out:
+  ret i1 false
+}
+
+; %join is also reached around the branch, so the fact does not hold there
+; CHECK-LABEL: @join(
+; CHECK: join:
+; CHECK-NEXT: %e = icmp eq i32 %x, 7
+; CHECK-NEXT: ret i1 %e
+define i1 @join(i32 %x) {
+entry:
+  %c = icmp slt i32 %x, 5
+  br i1 %c, label %small, label %join
+small:
+  br label %join
+join:
+  %e = icmp eq i32 %x, 7
+  ret i1 %e
+}
+
+; An equality makes %x a constant in the blocks it dominates, only there
+; CHECK-LABEL: @equal(
+; CHECK: three:
+; CHECK-NEXT: ret i32 4
+; CHECK: other:
+; CHECK-NEXT: %b = add i32 %x, 1
+define i32 @equal(i32 %x) {
+entry:
+  %c = icmp eq i32 %x, 3
+  br i1 %c, label %three, label %other
+three:
+  %a = add i32 %x, 1
+  ret i32 %a
+other:
+  %b = add i32 %x, 1
+  ret i32 %b
+}
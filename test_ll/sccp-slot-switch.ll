@@ -0,0 +1,44 @@
+; RUN: %opt -passes=unit-sccp -S %s | FileCheck %s
+
+; The store of 2 in the latch, reached only through the switch, reaches the
+; load in the header: neither the load nor the comparison folds
+; CHECK-LABEL: @slot_switch(
+; CHECK: %v = load i32, i32* %p
+; CHECK: %c = icmp eq i32 %v, 2
+; CHECK: br i1 %c, label %exit, label %body
+; CHECK: ret i32 %v
+define i32 @slot_switch(i32 %n) {
+entry:
+  %p = alloca i32
+  store i32 1, i32* %p
+  br label %header
+header:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  %v = load i32, i32* %p
+  %c = icmp eq i32 %v, 2
+  br i1 %c, label %exit, label %body
+body:
+  %i.next = add i32 %i, 1
+  switch i32 %i, label %latch [ i32 100, label %exit ]
+latch:
+  store i32 2, i32* %p
+  br label %header
+exit:
+  ret i32 %v
+}
+
+; A slot only stored in dead cases still folds
+; CHECK-LABEL: @slot_dead_case(
+; CHECK: ret i32 1
+define i32 @slot_dead_case() {
+entry:
+  %p = alloca i32
+  store i32 1, i32* %p
+  switch i32 0, label %join [ i32 1, label %dead ]
+dead:
+  store i32 2, i32* %p
+  br label %join
+join:
+  %v = load i32, i32* %p
+  ret i32 %v
+}
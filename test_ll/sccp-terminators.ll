@@ -0,0 +1,70 @@
+; RUN: %opt -passes=unit-sccp -S %s | FileCheck %s
+
+; Successors of every terminator become executable, not only of br
+
+; CHECK-LABEL: @switch_const(
+; CHECK: ret i32 20
+define i32 @switch_const() {
+entry:
+  switch i32 2, label %def [ i32 1, label %one
+                            i32 2, label %two ]
+one:
+  br label %join
+two:
+  br label %join
+def:
+  br label %join
+join:
+  %r = phi i32 [ 10, %one ], [ 20, %two ], [ 30, %def ]
+  ret i32 %r
+}
+
+; CHECK-LABEL: @switch_var(
+; CHECK: ret i32 5
+define i32 @switch_var(i32 %x) {
+entry:
+  switch i32 %x, label %join [ i32 1, label %case ]
+case:
+  %a = add i32 2, 3
+  br label %join
+join:
+  %r = phi i32 [ 5, %entry ], [ %a, %case ]
+  ret i32 %r
+}
+
+; CHECK-LABEL: @indirectbr_const(
+; CHECK: ret i32 2
+define i32 @indirectbr_const() {
+entry:
+  indirectbr i8* blockaddress(@indirectbr_const, %b), [label %a, label %b]
+a:
+  br label %join
+b:
+  br label %join
+join:
+  %r = phi i32 [ 1, %a ], [ 2, %b ]
+  ret i32 %r
+}
+
+declare i32 @f()
+declare i32 @__gxx_personality_v0(...)
+
+; The result of an invoke is not constant, its normal destination runs
+; CHECK-LABEL: @invoke(
+; CHECK: %c = icmp eq i32 %v, 0
+; CHECK: ret i32 3
+define i32 @invoke() personality i32 (...)* @__gxx_personality_v0 {
+entry:
+  %v = invoke i32 @f() to label %ok unwind label %lp
+ok:
+  %c = icmp eq i32 %v, 0
+  br i1 %c, label %zero, label %done
+zero:
+  br label %done
+done:
+  %a = add i32 1, 2
+  ret i32 %a
+lp:
+  %l = landingpad { i8*, i32 } cleanup
+  resume { i8*, i32 } %l
+}
@@ -0,0 +1,59 @@
+; RUN: %opt -passes=unit-sccp -S %s | FileCheck %s
+
+; After mem2reg, a variable set on one path only is undef on the other;
+; the phi may take the one defined value
+; CHECK-LABEL: @phi_undef(
+; CHECK: ret i32 6
+define i32 @phi_undef(i1 %c) {
+entry:
+  br i1 %c, label %set, label %join
+set:
+  br label %join
+join:
+  %p = phi i32 [ 5, %set ], [ undef, %entry ]
+  %r = add i32 %p, 1
+  ret i32 %r
+}
+
+; A frozen phi of undefs is one value for every use
+; CHECK-LABEL: @freeze_phi(
+; CHECK: ret i32 0
+define i32 @freeze_phi(i1 %c) {
+entry:
+  br i1 %c, label %a, label %join
+a:
+  br label %join
+join:
+  %p = phi i32 [ undef, %a ], [ undef, %entry ]
+  %f = freeze i32 %p
+  %r = sub i32 %f, %f
+  ret i32 %r
+}
+
+; Freezing a phi that merged undef with 7 keeps the 7
+; CHECK-LABEL: @freeze_merged(
+; CHECK: ret i32 7
+define i32 @freeze_merged(i1 %c) {
+entry:
+  br i1 %c, label %a, label %join
+a:
+  br label %join
+join:
+  %p = phi i32 [ 7, %a ], [ undef, %entry ]
+  %f = freeze i32 %p
+  ret i32 %f
+}
+
+; Two different defined values do not merge
+; CHECK-LABEL: @phi_defined(
+; CHECK: %p = phi i32 [ 3, %a ], [ 4, %entry ]
+define i32 @phi_defined(i1 %c) {
+entry:
+  br i1 %c, label %a, label %join
+a:
+  br label %join
+join:
+  %p = phi i32 [ 3, %a ], [ 4, %entry ]
+  %f = freeze i32 %p
+  ret i32 %f
+}
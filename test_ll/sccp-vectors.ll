@@ -0,0 +1,49 @@
+; RUN: %opt -passes=unit-sccp -S %s | FileCheck %s
+
+; Lane 0 stays constant through arithmetic while lane 1 is unknown
+; CHECK-LABEL: @lanes(
+; CHECK: ret i32 12
+define i32 @lanes(i32 %x) {
+  %v = insertelement <2 x i32> <i32 5, i32 0>, i32 %x, i32 1
+  %a = add <2 x i32> %v, <i32 1, i32 1>
+  %m = mul <2 x i32> %a, <i32 2, i32 2>
+  %e = extractelement <2 x i32> %m, i32 0
+  ret i32 %e
+}
+
+; shufflevector moves the constant lane to where it is read
+; CHECK-LABEL: @shuffle(
+; CHECK: ret i32 5
+define i32 @shuffle(i32 %x) {
+  %v = insertelement <2 x i32> <i32 5, i32 0>, i32 %x, i32 1
+  %s = shufflevector <2 x i32> %v, <2 x i32> undef, <4 x i32> <i32 1, i32 1, i32 1, i32 0>
+  %e = extractelement <4 x i32> %s, i32 3
+  ret i32 %e
+}
+
+; Vectors that differ in lane 1 still agree on lane 0
+; CHECK-LABEL: @phi_lane(
+; CHECK: ret i32 3
+define i32 @phi_lane(i1 %c) {
+entry:
+  br i1 %c, label %a, label %b
+a:
+  br label %join
+b:
+  br label %join
+join:
+  %p = phi <2 x i32> [ <i32 3, i32 1>, %a ], [ <i32 3, i32 2>, %b ]
+  %e = extractelement <2 x i32> %p, i32 0
+  ret i32 %e
+}
+
+; The unknown lane is left alone
+; CHECK-LABEL: @unknown_lane(
+; CHECK: %e = extractelement <2 x i32> %a, i32 1
+; CHECK: ret i32 %e
+define i32 @unknown_lane(i32 %x) {
+  %v = insertelement <2 x i32> <i32 5, i32 0>, i32 %x, i32 1
+  %a = add <2 x i32> %v, <i32 1, i32 1>
+  %e = extractelement <2 x i32> %a, i32 1
+  ret i32 %e
+}
@@ -0,0 +1,73 @@
+; RUN: %opt -passes=unit-specialize -S %s | FileCheck %s
+; RUN: %opt -passes=unit-specialize -S %s | FileCheck %s --check-prefix=BYVAL
+
+; The call in the loop passes %k = 2 often enough for a clone; the one
+; outside runs once and keeps the original callee
+; CHECK-LABEL: @main(
+; CHECK: call i32 @scale(i32 1, i32 3)
+; CHECK: call i32 @scale.spec(i32 %i, i32 2)
+define i32 @main() {
+entry:
+  %once = call i32 @scale(i32 1, i32 3)
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %s = phi i32 [ %once, %entry ], [ %s.next, %loop ]
+  %v = call i32 @scale(i32 %i, i32 2)
+  %s.next = add i32 %s, %v
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, 100
+  br i1 %c, label %loop, label %exit
+exit:
+  ret i32 %s.next
+}
+
+; CHECK-LABEL: define internal i32 @scale(
+; CHECK: switch i32 %k
+
+define internal i32 @scale(i32 %x, i32 %k) {
+entry:
+  switch i32 %k, label %other [ i32 2, label %two ]
+two:
+  %d = shl i32 %x, 1
+  ret i32 %d
+other:
+  %m = mul i32 %x, %k
+  ret i32 %m
+}
+
+; The switch on the constant is gone from the clone, with its dead case
+; CHECK-LABEL: define internal i32 @scale.spec(
+; CHECK-NOT: switch
+; CHECK-NOT: mul
+; CHECK: shl i32 %x, 1
+; CHECK-NOT: mul
+; CHECK: }
+
+; Each call bumps its own copy of @g: the clone must not bump @g itself
+%S = type { i32, i32 }
+@g = internal global %S { i32 15, i32 0 }
+
+; BYVAL-LABEL: @byval_loop(
+; BYVAL: call i32 @bump(%S* byval(%S) @g)
+define i32 @byval_loop() {
+entry:
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %v = call i32 @bump(%S* byval(%S) @g)
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, 100
+  br i1 %c, label %loop, label %exit
+exit:
+  ret i32 %v
+}
+
+; BYVAL-NOT: @bump.spec
+define internal i32 @bump(%S* byval(%S) %p) {
+  %f = getelementptr %S, %S* %p, i32 0, i32 0
+  %v = load i32, i32* %f
+  %n = add i32 %v, 1
+  store i32 %n, i32* %f
+  ret i32 %n
+}